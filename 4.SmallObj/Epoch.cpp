@@ -0,0 +1,307 @@
+#include "Epoch.h"
+#include "Threads.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+#ifdef __linux__
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace Loki;
+
+std::atomic<unsigned long long> Epoch::globalEpoch_(1);
+std::atomic<bool> Epoch::asymmetricFence_(false);
+thread_local Epoch::Record* Epoch::pLocal_ = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// struct Epoch::Limbo
+// A thread's retired objects, in three buckets indexed by the epoch (modulo 3)
+//     in which they were retired
+////////////////////////////////////////////////////////////////////////////////
+
+struct Epoch::Limbo
+{
+    struct Retired
+    {
+        void* p_;
+        ReclaimFn reclaim_;
+    };
+    typedef std::vector<Retired> Bucket;
+
+    Bucket buckets_[3];
+    unsigned long long epochs_[3];
+    std::size_t sinceCollect_;
+
+    Limbo() : sinceCollect_(0)
+    {
+        epochs_[0] = epochs_[1] = epochs_[2] = 0;
+    }
+};
+
+namespace // anoymous
+{
+    typedef Epoch::Limbo::Retired Retired;
+    typedef Epoch::Limbo::Bucket Bucket;
+
+    // All records ever created
+    std::atomic<Epoch::Record*> records(0);
+
+    // What exited threads left behind, with the epochs they were retired in
+    struct Orphan
+    {
+        unsigned long long epoch_;
+        Retired retired_;
+    };
+    Mutex orphansMutex;
+    std::vector<Orphan>* pOrphans = 0;
+    std::atomic<std::size_t> orphanCount(0);
+
+    bool ByReclaimFn(const Retired& lhs, const Retired& rhs)
+    {
+        return std::less<Epoch::ReclaimFn>()(lhs.reclaim_, rhs.reclaim_);
+    }
+
+    // Frees the objects of a bucket, one call per type
+    void Reclaim(Bucket& bucket)
+    {
+        if (bucket.empty()) return;
+        Bucket objects;
+        objects.swap(bucket);
+        std::sort(objects.begin(), objects.end(), ByReclaimFn);
+
+        std::vector<void*> batch;
+        batch.reserve(objects.size());
+        Bucket::const_iterator i = objects.begin();
+        while (i != objects.end())
+        {
+            const Epoch::ReclaimFn reclaim = i->reclaim_;
+            batch.clear();
+            for (; i != objects.end() && i->reclaim_ == reclaim; ++i)
+            {
+                batch.push_back(i->p_);
+            }
+            reclaim(&batch[0], batch.size());
+        }
+    }
+
+    bool RegisterAsymmetricFence()
+    {
+#if defined(__linux__) && defined(__NR_membarrier)
+        // Checks that the barrier itself works too, since readers will rely
+        //     on it
+        return ::syscall(__NR_membarrier,
+            MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0 &&
+            ::syscall(__NR_membarrier,
+            MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // The heavy half of the asymmetric fence: a full fence on every running
+    //     thread of the process
+    void HeavyFence(bool asymmetric)
+    {
+#if defined(__linux__) && defined(__NR_membarrier)
+        if (asymmetric)
+        {
+            ::syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+            return;
+        }
+#else
+        (void)asymmetric;
+#endif
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void ReclaimOrphans(unsigned long long epoch)
+    {
+        if (!orphanCount.load(std::memory_order_relaxed)) return;
+        Bucket safe;
+        {
+            orphansMutex.Lock();
+            std::vector<Orphan>& orphans = *pOrphans;
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i != orphans.size(); ++i)
+            {
+                if (orphans[i].epoch_ + 2 <= epoch)
+                {
+                    safe.push_back(orphans[i].retired_);
+                }
+                else
+                {
+                    orphans[kept++] = orphans[i];
+                }
+            }
+            orphans.resize(kept);
+            orphanCount.store(kept, std::memory_order_relaxed);
+            orphansMutex.Unlock();
+        }
+        Reclaim(safe);
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// struct Epoch::Releaser
+// Hands the record back when its thread exits; what's still retired is left to
+//     the other threads
+// The thread forgets the record, which another thread may take right away; if
+//     a thread_local destroyed later uses a guard, the thread gets a new record
+//     that is never handed back
+////////////////////////////////////////////////////////////////////////////////
+
+struct Epoch::Releaser
+{
+    Record* pRecord_;
+
+    ~Releaser()
+    {
+        if (!pRecord_) return;
+        Limbo& limbo = *pRecord_->pLimbo_;
+        orphansMutex.Lock();
+        if (!pOrphans) pOrphans = new std::vector<Orphan>;
+        for (unsigned b = 0; b != 3; ++b)
+        {
+            for (std::size_t i = 0; i != limbo.buckets_[b].size(); ++i)
+            {
+                Orphan orphan = { limbo.epochs_[b], limbo.buckets_[b][i] };
+                pOrphans->push_back(orphan);
+            }
+            limbo.buckets_[b].clear();
+        }
+        orphanCount.store(pOrphans->size(), std::memory_order_relaxed);
+        orphansMutex.Unlock();
+
+        pRecord_->state_.store(0, std::memory_order_relaxed);
+        pRecord_->nesting_ = 0;
+        pLocal_ = 0;
+        Record* pRecord = pRecord_;
+        pRecord_ = 0;
+        pRecord->inUse_.store(false, std::memory_order_release);
+    }
+};
+
+thread_local Epoch::Releaser Epoch::releaser_;
+
+////////////////////////////////////////////////////////////////////////////////
+// Epoch::Acquire (internal)
+// Finds a free record, or makes a new one
+////////////////////////////////////////////////////////////////////////////////
+
+Epoch::Record* Epoch::Acquire()
+{
+    // Thread-safe static initialization publishes the flag to every thread
+    //     that gets here, hence before any of them enters a guard
+    static const bool registered = (asymmetricFence_.store(
+        RegisterAsymmetricFence(), std::memory_order_relaxed), true);
+    (void)registered;
+
+    Record* pRecord = records.load(std::memory_order_acquire);
+    for (; pRecord; pRecord = pRecord->next_)
+    {
+        bool inUse = false;
+        if (pRecord->inUse_.compare_exchange_strong(inUse, true,
+            std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+    if (!pRecord)
+    {
+        pRecord = new Record;
+        pRecord->state_.store(0, std::memory_order_relaxed);
+        pRecord->nesting_ = 0;
+        pRecord->pLimbo_ = new Limbo;
+        pRecord->inUse_.store(true, std::memory_order_relaxed);
+        pRecord->next_ = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(pRecord->next_, pRecord,
+            std::memory_order_release, std::memory_order_relaxed))
+        {}
+    }
+    releaser_.pRecord_ = pRecord;
+    return pRecord;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Epoch::Retire
+////////////////////////////////////////////////////////////////////////////////
+
+void Epoch::Retire(void* p, ReclaimFn reclaim)
+{
+    Limbo& limbo = *Local().pLimbo_;
+    const unsigned long long epoch =
+        globalEpoch_.load(std::memory_order_acquire);
+    const unsigned b = epoch % 3;
+    if (limbo.epochs_[b] != epoch)
+    {
+        // Retired three or more epochs ago, hence safe
+        Reclaim(limbo.buckets_[b]);
+        limbo.epochs_[b] = epoch;
+    }
+    Retired retired = { p, reclaim };
+    limbo.buckets_[b].push_back(retired);
+
+    if (++limbo.sinceCollect_ >= EPOCH_RETIRE_BATCH) Collect();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Epoch::Collect
+// Advances the global epoch if every thread inside a guard has observed it
+////////////////////////////////////////////////////////////////////////////////
+
+void Epoch::Collect()
+{
+    Limbo& limbo = *Local().pLimbo_;
+    limbo.sinceCollect_ = 0;
+
+    HeavyFence(asymmetricFence_.load(std::memory_order_relaxed));
+    unsigned long long epoch = globalEpoch_.load(std::memory_order_seq_cst);
+    bool canAdvance = true;
+    for (Record* pRecord = records.load(std::memory_order_acquire); pRecord;
+        pRecord = pRecord->next_)
+    {
+        const unsigned long long state =
+            pRecord->state_.load(std::memory_order_acquire);
+        if ((state & 1) && (state >> 1) != epoch)
+        {
+            canAdvance = false;
+            break;
+        }
+    }
+    if (canAdvance &&
+        globalEpoch_.compare_exchange_strong(epoch, epoch + 1,
+            std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        ++epoch;
+    }
+
+    for (unsigned b = 0; b != 3; ++b)
+    {
+        if (limbo.epochs_[b] + 2 <= epoch) Reclaim(limbo.buckets_[b]);
+    }
+    ReclaimOrphans(epoch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Epoch::Synchronize
+////////////////////////////////////////////////////////////////////////////////
+
+void Epoch::Synchronize()
+{
+    Record& record = Local();
+    assert(record.nesting_ == 0);
+    for (;;)
+    {
+        Collect();
+        const Limbo& limbo = *record.pLimbo_;
+        if (limbo.buckets_[0].empty() && limbo.buckets_[1].empty() &&
+            limbo.buckets_[2].empty())
+        {
+            return;
+        }
+        ::sched_yield();
+    }
+}
@@ -0,0 +1,175 @@
+#ifndef EPOCH_INC_
+#define EPOCH_INC_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <typeinfo>
+
+#ifndef EPOCH_RETIRE_BATCH
+#define EPOCH_RETIRE_BATCH 64
+#endif
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class Epoch
+// Epoch-based reclamation: defers freeing the nodes of lock-free structures
+//     until no thread can still be reading them
+// Readers enter an EpochGuard before loading shared pointers; writers unlink a
+//     node, then Retire it. A node retired in epoch e is freed once the global
+//     epoch reaches e + 2, which requires every thread inside a guard to have
+//     observed e + 1
+// Retired nodes are kept per thread and freed in batches, grouped by type, so
+//     that SmallObject blocks go back to their pool under a single lock (see
+//     SmallObject::DeallocateBatch)
+// Entering a guard costs a thread-local store: on Linux the store-load fence
+//     that readers would need is paid instead by the reclaiming thread, with
+//     membarrier(); elsewhere, or if membarrier is unavailable, the guard
+//     issues a full fence
+////////////////////////////////////////////////////////////////////////////////
+
+    class Epoch
+    {
+    public:
+        // Frees n retired objects of the same type
+        typedef void (*ReclaimFn)(void* const* objects, std::size_t n);
+
+        // Retired objects of a thread; opaque
+        struct Limbo;
+
+        // Per-thread state, linked in a list that the reclaiming threads scan
+        //     (records of exited threads get reused)
+        struct Record
+        {
+            // (epoch << 1) | 1 while inside a guard, 0 outside
+            std::atomic<unsigned long long> state_;
+            unsigned nesting_;
+            Limbo* pLimbo_;
+            std::atomic<bool> inUse_;
+            Record* next_;
+        };
+
+        // Schedules 'reclaim' to be called on p once all current readers
+        //     are done
+        static void Retire(void* p, ReclaimFn reclaim);
+
+        // Tries to advance the epoch, and frees what the calling thread
+        //     retired that has become safe to free
+        static void Collect();
+
+        // Blocks until everything the calling thread retired so far is freed;
+        //     must not be called from within an EpochGuard
+        static void Synchronize();
+
+        // The calling thread's record
+        static Record& Local()
+        {
+            if (!pLocal_) pLocal_ = Acquire();
+            return *pLocal_;
+        }
+
+        static void Enter(Record& r)
+        {
+            if (r.nesting_++ != 0) return;
+            r.state_.store(
+                globalEpoch_.load(std::memory_order_relaxed) << 1 | 1,
+                std::memory_order_relaxed);
+            // Orders the store above before the loads of shared pointers
+            if (asymmetricFence_.load(std::memory_order_relaxed))
+            {
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+            else
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        static void Leave(Record& r)
+        {
+            if (--r.nesting_ == 0)
+            {
+                r.state_.store(0, std::memory_order_release);
+            }
+        }
+
+    private:
+        // Hands the record back when its thread exits
+        struct Releaser;
+
+        static Record* Acquire();
+
+        static std::atomic<unsigned long long> globalEpoch_;
+        // Set once, before the first record is handed out
+        static std::atomic<bool> asymmetricFence_;
+        static thread_local Record* pLocal_;
+        static thread_local Releaser releaser_;
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class EpochGuard
+// Read-side critical section: pointers loaded from a lock-free structure while
+//     a guard is alive stay valid until the guard goes away
+// Guards nest
+////////////////////////////////////////////////////////////////////////////////
+
+    class EpochGuard
+    {
+        Epoch::Record& record_;
+
+        EpochGuard(const EpochGuard&);
+        EpochGuard& operator=(const EpochGuard&);
+
+    public:
+        EpochGuard() : record_(Epoch::Local())
+        { Epoch::Enter(record_); }
+
+        ~EpochGuard()
+        { Epoch::Leave(record_); }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// function template Retire
+// Deletes p once no EpochGuard that could have seen it is alive
+// p must point to a complete T, not to a subobject; types offering a static
+//     DeallocateBatch (SmallObject) are destroyed, then returned to their pool
+//     in one call per batch
+////////////////////////////////////////////////////////////////////////////////
+
+    namespace Private
+    {
+        template <class T>
+        auto ReclaimBatch(void* const* objects, std::size_t n, int)
+            -> decltype(T::DeallocateBatch(objects, n, sizeof(T)), void())
+        {
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                static_cast<T*>(objects[i])->~T();
+            }
+            T::DeallocateBatch(objects, n, sizeof(T));
+        }
+
+        template <class T>
+        void ReclaimBatch(void* const* objects, std::size_t n, long)
+        {
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                delete static_cast<T*>(objects[i]);
+            }
+        }
+
+        template <class T>
+        void ReclaimBatch(void* const* objects, std::size_t n)
+        { ReclaimBatch<T>(objects, n, 0); }
+    }
+
+    template <class T>
+    void Retire(T* p)
+    {
+        assert(typeid(*p) == typeid(T));
+        Epoch::Retire(p, &Private::ReclaimBatch<T>);
+    }
+} // namespace Loki
+
+#endif // EPOCH_INC_
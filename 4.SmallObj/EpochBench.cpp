@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+// Epoch-based reclamation on SmallObject nodes
+// Measures the cost of an EpochGuard against a Lock, then runs a lock-free
+//     (Treiber) stack whose popped nodes are Retired, from 1 to N threads,
+//     checking that every pushed value is popped exactly once
+// Build: g++ -O2 -pthread EpochBench.cpp Epoch.cpp SmallObj.cpp Singleton.cpp
+//     HeapProfiler.cpp
+// Usage: ./a.out [operations per thread]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Epoch.h"
+#include "SmallObj.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace Loki;
+
+namespace
+{
+    struct Node : public SmallObject<ClassLevelLockable>
+    {
+        long value_;
+        Node* next_;
+    };
+
+    class Stack
+    {
+        std::atomic<Node*> head_;
+
+    public:
+        Stack() : head_(0)
+        {}
+
+        ~Stack()
+        {
+            while (Node* p = head_.load())
+            {
+                head_.store(p->next_);
+                delete p;
+            }
+        }
+
+        void Push(long value)
+        {
+            Node* p = new Node;
+            p->value_ = value;
+            p->next_ = head_.load(std::memory_order_relaxed);
+            while (!head_.compare_exchange_weak(p->next_, p,
+                std::memory_order_release, std::memory_order_relaxed))
+            {}
+        }
+
+        bool Pop(long& value)
+        {
+            Node* p;
+            {
+                EpochGuard guard;
+                p = head_.load(std::memory_order_acquire);
+                // p->next_ is read while p may be popped (and retired) by
+                //     another thread: the guard keeps it alive
+                while (p && !head_.compare_exchange_weak(p, p->next_,
+                    std::memory_order_acquire, std::memory_order_acquire))
+                {}
+            }
+            if (!p) return false;
+            value = p->value_;
+            Retire(p);
+            return true;
+        }
+    };
+
+    double Elapsed(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct Locked : public ObjectLevelLockable<Locked>
+    {};
+
+    void GuardCost(unsigned long iterations)
+    {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i != iterations; ++i)
+        {
+            EpochGuard guard;
+            (void)guard;
+        }
+        std::printf("%-28s %8.2f ns\n", "EpochGuard",
+            Elapsed(start) / iterations);
+
+        Locked locked;
+        start = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i != iterations; ++i)
+        {
+            Locked::Lock lock(locked);
+            (void)lock;
+        }
+        std::printf("%-28s %8.2f ns\n", "ObjectLevelLockable::Lock",
+            Elapsed(start) / iterations);
+    }
+
+    // Each thread pushes its share of values and pops as many
+    void StackRun(unsigned threads, unsigned long iterations)
+    {
+        Stack stack;
+        std::atomic<long> sum(0);
+        std::vector<std::thread> pool;
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (unsigned t = 0; t != threads; ++t)
+        {
+            pool.push_back(std::thread([&, t]()
+            {
+                long local = 0;
+                for (unsigned long i = 0; i != iterations; ++i)
+                {
+                    stack.Push(long(t * iterations + i));
+                    long value;
+                    if (stack.Pop(value)) local += value;
+                }
+                Epoch::Synchronize();
+                sum += local;
+            }));
+        }
+        for (unsigned t = 0; t != threads; ++t) pool[t].join();
+        const double ns = Elapsed(start) / (double(threads) * iterations);
+
+        const long n = long(threads * iterations);
+        std::printf("%-28s %8.2f ns per push+pop%s\n",
+            (std::to_string(threads) + " thread(s)").c_str(), ns,
+            sum.load() == n * (n - 1) / 2 ? "" : "  (values lost!)");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned long iterations = argc > 1
+        ? std::strtoul(argv[1], 0, 10) : 1000000;
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 2;
+
+    GuardCost(iterations * 10);
+    std::printf("\nlock-free stack, popped nodes retired\n");
+    for (unsigned n = 1; n <= threads * 2; n *= 2)
+    {
+        StackRun(n, iterations / n);
+    }
+    return 0;
+}
@@ -0,0 +1,464 @@
+#ifndef HANDLEPOOL_INC_
+#define HANDLEPOOL_INC_
+
+#include "SmallObj.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class template Handle
+// Stable reference to an object living in a HandlePool
+// Resolves through the pool's indirection table, so it survives the object
+//     being moved by HandlePool::Compact
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class T>
+    class Handle
+    {
+        template <class, template <class> class> friend class HandlePool;
+
+        enum { nullIndex = ~0u };
+
+        unsigned index_;
+        unsigned generation_;
+
+        Handle(unsigned index, unsigned generation)
+        : index_(index), generation_(generation)
+        {}
+
+    public:
+        Handle() : index_(nullIndex), generation_(0)
+        {}
+
+        bool IsNull() const
+        { return index_ == nullIndex; }
+
+        friend bool operator==(const Handle& lhs, const Handle& rhs)
+        {
+            return lhs.index_ == rhs.index_ &&
+                lhs.generation_ == rhs.generation_;
+        }
+
+        friend bool operator!=(const Handle& lhs, const Handle& rhs)
+        { return !(lhs == rhs); }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class template HandlePool
+// Opt-in handle-based object model for objects of type T
+// Objects live in fixed-size chunks like the ones of FixedAllocator, but
+//     clients hold Handles instead of pointers, so Compact can move live
+//     objects out of sparsely used chunks (with T's move constructor, which
+//     must not throw) and release those chunks, returning memory after a
+//     usage spike
+// Pointers obtained through Resolve are valid until the next call to Compact;
+//     when another thread may compact concurrently, access the object through
+//     a Pinned guard, which holds the pool's lock
+// The lock isn't recursive: a thread holding a Pinned must not call the
+//     pool's Create, Destroy, Resolve or Compact (debug builds assert on it)
+////////////////////////////////////////////////////////////////////////////////
+
+    template
+    <
+        class T,
+        template <class> class ThreadingModel = DEFAULT_THREADING
+    >
+    class HandlePool : public ThreadingModel< HandlePool<T, ThreadingModel> >
+    {
+        typedef ThreadingModel< HandlePool<T, ThreadingModel> >
+            MyThreadingModel;
+        typedef typename MyThreadingModel::Lock Lock;
+
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+            "HandlePool does not support over-aligned types");
+
+        enum { noOwner = ~0u };
+
+        struct Chunk
+        {
+            unsigned char* pData_;
+            // Handle index of the object in each slot, noOwner if free
+            std::vector<unsigned> owners_;
+            std::vector<unsigned> freeSlots_;
+            // Set while Compact moves objects out of the chunk
+            bool evacuating_;
+
+            std::size_t Live() const
+            { return owners_.size() - freeSlots_.size(); }
+
+            T* Slot(unsigned slot) const
+            { return reinterpret_cast<T*>(pData_ + slot * sizeof(T)); }
+        };
+
+        // Entry of the indirection table
+        struct Entry
+        {
+            Chunk* pChunk_;
+            unsigned slot_;
+            unsigned generation_;
+            unsigned nextFree_;
+        };
+
+        typedef std::vector<Chunk*> Chunks;
+
+    public:
+        typedef Handle<T> HandleType;
+
+        explicit HandlePool(std::size_t chunkSize = DEFAULT_CHUNK_SIZE)
+        : blocksPerChunk_(chunkSize / sizeof(T) ? chunkSize / sizeof(T) : 1)
+        , allocChunk_(0)
+        , freeEntry_(HandleType::nullIndex)
+        , live_(0)
+        {}
+
+        ~HandlePool()
+        {
+            typename Chunks::iterator i = chunks_.begin();
+            for (; i != chunks_.end(); ++i)
+            {
+                Chunk* pChunk = *i;
+                for (unsigned slot = 0; slot != pChunk->owners_.size(); ++slot)
+                {
+                    if (pChunk->owners_[slot] != noOwner)
+                    {
+                        pChunk->Slot(slot)->~T();
+                    }
+                }
+                ReleaseChunk(pChunk);
+            }
+        }
+
+        // Constructs a T from 'args' and returns a handle to it
+        template <class... Args>
+        HandleType Create(Args&&... args)
+        {
+            AssertNotPinned();
+            Lock lock(*this);
+            (void)lock; // get rid of warning
+
+            // Everything that can throw comes before the object is built, so
+            //     that only T's constructor is left to undo
+            Chunk* pChunk = ChunkForAllocation();
+            const unsigned slot = pChunk->freeSlots_.back();
+            const unsigned index = NewEntry();
+            try
+            {
+                ::new(pChunk->Slot(slot)) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                entries_[index].nextFree_ = freeEntry_;
+                freeEntry_ = index;
+                throw;
+            }
+            pChunk->freeSlots_.pop_back();
+
+            Entry& entry = entries_[index];
+            entry.pChunk_ = pChunk;
+            entry.slot_ = slot;
+            pChunk->owners_[slot] = index;
+            ++live_;
+            return HandleType(index, entry.generation_);
+        }
+
+        // Destroys the object referred to by 'h'; 'h' and its copies become
+        //     dangling (Resolve asserts on them)
+        void Destroy(HandleType h)
+        {
+            AssertNotPinned();
+            Lock lock(*this);
+            (void)lock; // get rid of warning
+
+            Entry& entry = GetEntry(h);
+            Chunk* pChunk = entry.pChunk_;
+            pChunk->Slot(entry.slot_)->~T();
+            FreeSlot(pChunk, entry.slot_);
+
+            ++entry.generation_;
+            entry.pChunk_ = 0;
+            entry.nextFree_ = freeEntry_;
+            freeEntry_ = h.index_;
+            --live_;
+
+            // Keep a single empty chunk around
+            if (pChunk->Live() == 0 && pChunk != allocChunk_)
+            {
+                RemoveChunk(pChunk);
+            }
+        }
+
+        // Returns the current address of the object referred to by 'h'
+        T* Resolve(HandleType h) const
+        {
+            AssertNotPinned();
+            Lock lock(*this);
+            (void)lock; // get rid of warning
+
+            const Entry& entry = GetEntry(h);
+            return entry.pChunk_->Slot(entry.slot_);
+        }
+
+        // Moves live objects out of chunks at most 'maxOccupancy' full into
+        //     fuller chunks, and releases the chunks thus emptied
+        // Performs at most 'maxMoves' moves, so that a background thread can
+        //     compact in slices without holding the lock for long
+        // Returns the number of chunks released
+        std::size_t Compact(double maxOccupancy = 0.25,
+            std::size_t maxMoves = std::size_t(-1))
+        {
+            // A move that throws would leave the pool half compacted
+            static_assert(std::is_nothrow_move_constructible<T>::value,
+                "HandlePool::Compact needs a non-throwing move constructor");
+
+            AssertNotPinned();
+            Lock lock(*this);
+            (void)lock; // get rid of warning
+
+            // Sparse chunks are evacuated emptiest first, into the fullest
+            //     chunks that aren't being evacuated; when those run out of
+            //     room, the fullest sparse chunks stop being evacuated and
+            //     become targets
+            Chunks sparse;
+            typename Chunks::iterator i = chunks_.begin();
+            for (; i != chunks_.end(); ++i)
+            {
+                if ((*i)->Live() <= maxOccupancy * blocksPerChunk_)
+                {
+                    (*i)->evacuating_ = true;
+                    sparse.push_back(*i);
+                }
+            }
+            std::sort(sparse.begin(), sparse.end(), LessLive);
+
+            std::size_t released = 0;
+            std::size_t lo = 0, hi = sparse.size();
+            Chunk* pTo = 0;
+            for (; lo < hi && maxMoves; ++lo)
+            {
+                Chunk* pFrom = sparse[lo];
+                for (unsigned slot = 0; pFrom->Live() && maxMoves &&
+                    slot != pFrom->owners_.size(); ++slot)
+                {
+                    const unsigned index = pFrom->owners_[slot];
+                    if (index == noOwner) continue;
+
+                    if (!pTo || pTo->freeSlots_.empty())
+                    {
+                        pTo = CompactionTarget();
+                    }
+                    while (!pTo && hi > lo + 1)
+                    {
+                        sparse[--hi]->evacuating_ = false;
+                        pTo = CompactionTarget();
+                    }
+                    if (!pTo) break;
+                    const unsigned toSlot = pTo->freeSlots_.back();
+
+                    T* pOld = pFrom->Slot(slot);
+                    ::new(pTo->Slot(toSlot)) T(std::move(*pOld));
+                    pOld->~T();
+                    pTo->freeSlots_.pop_back();
+                    pTo->owners_[toSlot] = index;
+                    FreeSlot(pFrom, slot);
+
+                    entries_[index].pChunk_ = pTo;
+                    entries_[index].slot_ = toSlot;
+                    --maxMoves;
+                }
+                if (pFrom->Live() == 0)
+                {
+                    if (allocChunk_ == pFrom) allocChunk_ = 0;
+                    RemoveChunk(pFrom);
+                    sparse[lo] = 0;
+                    ++released;
+                }
+            }
+            for (i = sparse.begin(); i != sparse.end(); ++i)
+            {
+                if (*i) (*i)->evacuating_ = false;
+            }
+            return released;
+        }
+
+        // Number of live objects and of chunks holding them
+        std::size_t Size() const
+        { return live_; }
+
+        std::size_t ChunkCount() const
+        { return chunks_.size(); }
+
+        // Keeps the pool from compacting while the object is being used
+        class Pinned
+        {
+            Lock lock_;
+            T* p_;
+#ifndef NDEBUG
+            const HandlePool* pPreviousPin_;
+#endif
+
+            Pinned(const Pinned&);
+            Pinned& operator=(const Pinned&);
+        public:
+            Pinned(const HandlePool& pool, HandleType h)
+            : lock_(pool)
+            {
+                const Entry& entry = pool.GetEntry(h);
+                p_ = entry.pChunk_->Slot(entry.slot_);
+#ifndef NDEBUG
+                pPreviousPin_ = PinnedPool();
+                PinnedPool() = &pool;
+#endif
+            }
+
+#ifndef NDEBUG
+            ~Pinned()
+            { PinnedPool() = pPreviousPin_; }
+#endif
+
+            T* operator->() const
+            { return p_; }
+
+            T& operator*() const
+            { return *p_; }
+        };
+
+    private:
+        HandlePool(const HandlePool&);
+        HandlePool& operator=(const HandlePool&);
+
+        static bool LessLive(const Chunk* lhs, const Chunk* rhs)
+        { return lhs->Live() < rhs->Live(); }
+
+        // The pool pinned last by the calling thread, in debug builds
+        static const HandlePool*& PinnedPool()
+        {
+            static thread_local const HandlePool* pPool = 0;
+            return pPool;
+        }
+
+        // Taking the lock again would deadlock
+        void AssertNotPinned() const
+        {
+#ifndef NDEBUG
+            assert(PinnedPool() != this);
+#endif
+        }
+
+        const Entry& GetEntry(HandleType h) const
+        {
+            assert(h.index_ < entries_.size());
+            assert(entries_[h.index_].generation_ == h.generation_);
+            assert(entries_[h.index_].pChunk_);
+            return entries_[h.index_];
+        }
+
+        Entry& GetEntry(HandleType h)
+        {
+            return const_cast<Entry&>(
+                static_cast<const HandlePool&>(*this).GetEntry(h));
+        }
+
+        unsigned NewEntry()
+        {
+            if (freeEntry_ != HandleType::nullIndex)
+            {
+                const unsigned index = freeEntry_;
+                freeEntry_ = entries_[index].nextFree_;
+                return index;
+            }
+            Entry entry = { 0, 0, 0, HandleType::nullIndex };
+            entries_.push_back(entry);
+            assert(entries_.size() < HandleType::nullIndex);
+            return static_cast<unsigned>(entries_.size() - 1);
+        }
+
+        // Returns a chunk with a free slot, preferring the fullest one so that
+        //     objects stay packed
+        Chunk* ChunkForAllocation()
+        {
+            if (allocChunk_ && !allocChunk_->freeSlots_.empty())
+            {
+                return allocChunk_;
+            }
+            allocChunk_ = CompactionTarget();
+            if (!allocChunk_) allocChunk_ = AddChunk();
+            return allocChunk_;
+        }
+
+        // Returns the fullest chunk that has a free slot and isn't being
+        //     evacuated, or null
+        Chunk* CompactionTarget() const
+        {
+            Chunk* pBest = 0;
+            typename Chunks::const_iterator i = chunks_.begin();
+            for (; i != chunks_.end(); ++i)
+            {
+                if ((*i)->freeSlots_.empty() || (*i)->evacuating_) continue;
+                if (!pBest || (*i)->Live() > pBest->Live()) pBest = *i;
+            }
+            return pBest;
+        }
+
+        // Releases the chunk, and its data once allocated, if AddChunk throws
+        struct ChunkReleaser
+        {
+            void operator()(Chunk* pChunk) const
+            { ReleaseChunk(pChunk); }
+        };
+
+        Chunk* AddChunk()
+        {
+            // Value initialized: pData_ is null until allocated
+            std::unique_ptr<Chunk, ChunkReleaser> pChunk(new Chunk());
+            pChunk->pData_ = static_cast<unsigned char*>(
+                ::operator new(blocksPerChunk_ * sizeof(T)));
+            pChunk->owners_.assign(blocksPerChunk_, unsigned(noOwner));
+            pChunk->freeSlots_.reserve(blocksPerChunk_);
+            for (std::size_t slot = blocksPerChunk_; slot != 0; --slot)
+            {
+                pChunk->freeSlots_.push_back(static_cast<unsigned>(slot - 1));
+            }
+            chunks_.push_back(pChunk.get());
+            return pChunk.release();
+        }
+
+        void FreeSlot(Chunk* pChunk, unsigned slot)
+        {
+            pChunk->owners_[slot] = noOwner;
+            pChunk->freeSlots_.push_back(slot);
+        }
+
+        void RemoveChunk(Chunk* pChunk)
+        {
+            typename Chunks::iterator i =
+                std::find(chunks_.begin(), chunks_.end(), pChunk);
+            assert(i != chunks_.end());
+            *i = chunks_.back();
+            chunks_.pop_back();
+            ReleaseChunk(pChunk);
+        }
+
+        static void ReleaseChunk(Chunk* pChunk)
+        {
+            ::operator delete(pChunk->pData_);
+            delete pChunk;
+        }
+
+        std::size_t blocksPerChunk_;
+        Chunks chunks_;
+        Chunk* allocChunk_;
+        std::vector<Entry> entries_;
+        unsigned freeEntry_;
+        std::size_t live_;
+    };
+} // namespace Loki
+
+#endif // HANDLEPOOL_INC_
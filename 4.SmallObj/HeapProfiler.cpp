@@ -0,0 +1,210 @@
+#include "HeapProfiler.h"
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <vector>
+#include <execinfo.h>
+
+using namespace Loki;
+
+////////////////////////////////////////////////////////////////////////////////
+// struct HeapProfiler::Samples
+// Per call site statistics, plus the live samples pointing into them
+////////////////////////////////////////////////////////////////////////////////
+
+struct HeapProfiler::Samples
+{
+    struct Site
+    {
+        std::size_t size_;
+        std::vector<void*> stack_;
+
+        bool operator<(const Site& rhs) const
+        {
+            if (size_ != rhs.size_) return size_ < rhs.size_;
+            return stack_ < rhs.stack_;
+        }
+    };
+
+    struct SiteStats
+    {
+        std::size_t liveObjects_;
+        std::size_t allocatedObjects_;
+    };
+
+    typedef std::map<Site, SiteStats> Sites;
+    typedef std::map<void*, SiteStats*> Live;
+
+    Sites sites_;
+    Live live_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapProfiler::~HeapProfiler
+////////////////////////////////////////////////////////////////////////////////
+
+HeapProfiler::~HeapProfiler()
+{
+    delete pSamples_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapProfiler::SetSamplingInterval
+////////////////////////////////////////////////////////////////////////////////
+
+void HeapProfiler::SetSamplingInterval(std::size_t meanBytes)
+{
+    samplingInterval_ = meanBytes;
+    bytesUntilSample_ = NextSampleDistance();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapProfiler::NextSampleDistance (internal)
+// Draws the number of bytes until the next sample from an exponential
+//     distribution whose mean is the sampling interval
+////////////////////////////////////////////////////////////////////////////////
+
+long long HeapProfiler::NextSampleDistance()
+{
+    if (samplingInterval_ == 0) return LLONG_MAX;
+
+    // xorshift64*
+    rng_ ^= rng_ >> 12;
+    rng_ ^= rng_ << 25;
+    rng_ ^= rng_ >> 27;
+    const unsigned long long r = rng_ * 2685821657736338717ULL;
+
+    // Uniform in (0, 1]
+    const double u = (static_cast<double>(r >> 11) + 1.0) / 9007199254740992.0;
+    return static_cast<long long>(-std::log(u) * samplingInterval_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapProfiler::Sample (internal)
+// Records the call site of an allocation and starts tracking the block
+////////////////////////////////////////////////////////////////////////////////
+
+void HeapProfiler::Sample(void* p, std::size_t numBytes)
+{
+    bytesUntilSample_ = NextSampleDistance();
+    if (samplingInterval_ == 0) return;
+
+    if (!pSamples_) pSamples_ = new Samples;
+
+    void* stack[HEAP_PROFILER_MAX_DEPTH + 2];
+    int depth = ::backtrace(stack, HEAP_PROFILER_MAX_DEPTH + 2);
+
+    // Drop our own frame and the allocator's
+    Samples::Site site;
+    site.size_ = numBytes;
+    if (depth > 2) site.stack_.assign(stack + 2, stack + depth);
+
+    Samples::SiteStats& stats = pSamples_->sites_[site];
+    ++stats.allocatedObjects_;
+    ++stats.liveObjects_;
+
+    pSamples_->live_[p] = &stats;
+    ++liveSamples_;
+    unsigned char& count = filter_[FilterIndex(p)];
+    // A saturated counter stays set for good
+    if (count != UCHAR_MAX) ++count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapProfiler::Unsample (internal)
+// Stops tracking a block if it was sampled
+////////////////////////////////////////////////////////////////////////////////
+
+void HeapProfiler::Unsample(void* p)
+{
+    assert(pSamples_);
+    Samples::Live::iterator i = pSamples_->live_.find(p);
+    if (i == pSamples_->live_.end()) return;
+
+    --i->second->liveObjects_;
+    pSamples_->live_.erase(i);
+    --liveSamples_;
+    unsigned char& count = filter_[FilterIndex(p)];
+    if (count != UCHAR_MAX) --count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapProfiler::Dump
+////////////////////////////////////////////////////////////////////////////////
+
+void HeapProfiler::Dump(std::ostream& os, Format format) const
+{
+    Samples::Sites empty;
+    const Samples::Sites& sites = pSamples_ ? pSamples_->sites_ : empty;
+    Samples::Sites::const_iterator i;
+
+    std::size_t liveObjects = 0, liveBytes = 0;
+    std::size_t allocatedObjects = 0, allocatedBytes = 0;
+    for (i = sites.begin(); i != sites.end(); ++i)
+    {
+        liveObjects += i->second.liveObjects_;
+        liveBytes += i->second.liveObjects_ * i->first.size_;
+        allocatedObjects += i->second.allocatedObjects_;
+        allocatedBytes += i->second.allocatedObjects_ * i->first.size_;
+    }
+
+    if (format == PprofFormat)
+    {
+        os << "heap profile: " << liveObjects << ": " << liveBytes
+           << " [" << allocatedObjects << ": " << allocatedBytes
+           << "] @ heap_v2/" << samplingInterval_ << '\n';
+        for (i = sites.begin(); i != sites.end(); ++i)
+        {
+            os << ' ' << i->second.liveObjects_ << ": "
+               << i->second.liveObjects_ * i->first.size_
+               << " [" << i->second.allocatedObjects_ << ": "
+               << i->second.allocatedObjects_ * i->first.size_ << "] @";
+            for (std::size_t j = 0; j != i->first.stack_.size(); ++j)
+            {
+                os << ' ' << i->first.stack_[j];
+            }
+            os << '\n';
+        }
+        // pprof needs the mappings to symbolize the addresses
+        os << "\nMAPPED_LIBRARIES:\n";
+        std::ifstream maps("/proc/self/maps");
+        os << maps.rdbuf();
+        return;
+    }
+
+    os << "SmallObjAllocator heap profile, sampling interval "
+       << samplingInterval_ << " bytes\n"
+       << "sampled live: " << liveObjects << " objects, " << liveBytes
+       << " bytes; sampled allocated: " << allocatedObjects << " objects, "
+       << allocatedBytes << " bytes\n\n"
+       << std::setw(10) << "size" << std::setw(12) << "live objs"
+       << std::setw(12) << "live bytes" << std::setw(12) << "alloc objs"
+       << std::setw(14) << "alloc bytes" << "  call site\n";
+    for (i = sites.begin(); i != sites.end(); ++i)
+    {
+        os << std::setw(10) << i->first.size_
+           << std::setw(12) << i->second.liveObjects_
+           << std::setw(12) << i->second.liveObjects_ * i->first.size_
+           << std::setw(12) << i->second.allocatedObjects_
+           << std::setw(14) << i->second.allocatedObjects_ * i->first.size_
+           << '\n';
+
+        const std::vector<void*>& stack = i->first.stack_;
+        if (stack.empty()) continue;
+        char** symbols = ::backtrace_symbols(&stack[0],
+            static_cast<int>(stack.size()));
+        for (std::size_t j = 0; j != stack.size(); ++j)
+        {
+            os << std::setw(62) << "" << "  ";
+            if (symbols) os << symbols[j];
+            else os << stack[j];
+            os << '\n';
+        }
+        std::free(symbols);
+    }
+}
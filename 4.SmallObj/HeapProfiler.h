@@ -0,0 +1,102 @@
+#ifndef HEAPPROFILER_INC_
+#define HEAPPROFILER_INC_
+
+#include <climits>
+#include <cstddef>
+#include <iosfwd>
+
+#ifndef HEAP_PROFILER_MAX_DEPTH
+#define HEAP_PROFILER_MAX_DEPTH 32
+#endif
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class HeapProfiler
+// Sampling heap profiler used by SmallObjAllocator
+// Roughly once every N allocated bytes (the sampling interval, randomized with
+//     an exponential distribution so that periodic allocation patterns can't
+//     hide from it) records a stack backtrace along with the size class
+// Sampled blocks are tracked until they are deallocated, so a dump shows both
+//     what's live and what has been allocated, by call site and size class
+// Disabled by default; when disabled (or between samples) an allocation costs
+//     a subtraction and a branch, and a deallocation a single load unless live
+//     samples exist
+// Not synchronized: the owner serializes calls (SmallObject does that through
+//     its ThreadingModel)
+////////////////////////////////////////////////////////////////////////////////
+
+    class HeapProfiler
+    {
+    public:
+        enum Format
+        {
+            // Human-readable table, with symbolized call sites
+            TextFormat,
+            // pprof's legacy heap profile format ("heap_v2")
+            PprofFormat
+        };
+
+        // constexpr so that an allocator can be constant initialized
+        constexpr HeapProfiler()
+            : samplingInterval_(0)
+            , bytesUntilSample_(LLONG_MAX)
+            , rng_(0x2545F4914F6CDD1DULL)
+            , liveSamples_(0)
+            , filter_()
+            , pSamples_(0)
+        {}
+        ~HeapProfiler();
+
+        // Sets the mean number of bytes between samples; 0 disables sampling
+        //     (already live samples keep being tracked)
+        void SetSamplingInterval(std::size_t meanBytes);
+        std::size_t SamplingInterval() const
+        { return samplingInterval_; }
+
+        // Hooks called by the allocator
+        void RecordAllocation(void* p, std::size_t numBytes)
+        {
+            bytesUntilSample_ -= static_cast<long long>(numBytes);
+            if (bytesUntilSample_ < 0) Sample(p, numBytes);
+        }
+        void RecordDeallocation(void* p)
+        {
+            if (liveSamples_ && filter_[FilterIndex(p)]) Unsample(p);
+        }
+
+        // Writes the profile gathered so far
+        void Dump(std::ostream& os, Format format = TextFormat) const;
+
+    private:
+        HeapProfiler(const HeapProfiler&);
+        HeapProfiler& operator=(const HeapProfiler&);
+
+        // Call sites and live samples, created with the first sample
+        struct Samples;
+
+        // Counting filter over the addresses of live samples; lets most
+        //     deallocations skip the lookup of live samples
+        enum { filterBits = 12 };
+
+        static std::size_t FilterIndex(void* p)
+        {
+            std::size_t bits = reinterpret_cast<std::size_t>(p) >> 3;
+            return static_cast<std::size_t>(
+                (bits * 0x9E3779B97F4A7C15ULL) >> (64 - filterBits));
+        }
+
+        void Sample(void* p, std::size_t numBytes);
+        void Unsample(void* p);
+        long long NextSampleDistance();
+
+        std::size_t samplingInterval_;
+        long long bytesUntilSample_;
+        unsigned long long rng_;
+        std::size_t liveSamples_;
+        unsigned char filter_[1 << filterBits];
+        Samples* pSamples_;
+    };
+} // namespace Loki
+
+#endif // HEAPPROFILER_INC_
@@ -0,0 +1,199 @@
+#include "LockProfiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cxxabi.h>
+
+using namespace Loki;
+
+thread_local const char* LockProfiler::site_ = 0;
+
+namespace // anoymous
+{
+    // Open addressing table of statistics, keyed by host and site
+    // Entries are never removed, so a slot only ever goes from empty to full
+    const std::size_t tableSize = 4096;
+
+    std::atomic<LockProfiler::Stats*> table[tableSize];
+
+    // Where everything goes once the table is full
+    struct TableFull {};
+
+    LockProfiler::Stats& Overflow()
+    {
+        static LockProfiler::Stats* pOverflow = []()
+        {
+            LockProfiler::Stats* pStats = new LockProfiler::Stats();
+            pStats->host_ = &typeid(TableFull);
+            return pStats;
+        }();
+        return *pOverflow;
+    }
+
+    void Clear(LockProfiler::Stats& stats)
+    {
+        stats.acquisitions_.store(0, std::memory_order_relaxed);
+        stats.contended_.store(0, std::memory_order_relaxed);
+        stats.waitNs_.store(0, std::memory_order_relaxed);
+        stats.holdNs_.store(0, std::memory_order_relaxed);
+        for (unsigned j = 0; j != LockProfiler::buckets; ++j)
+        {
+            stats.wait_[j].store(0, std::memory_order_relaxed);
+            stats.hold_[j].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool Matches(const LockProfiler::Stats& stats, const std::type_info& host,
+        const char* site)
+    {
+        return stats.site_ == site && *stats.host_ == host;
+    }
+
+    std::string Demangle(const char* name)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name, 0, 0, &status);
+        if (!demangled) return name;
+        std::string result(demangled);
+        std::free(demangled);
+        return result;
+    }
+
+    // Smallest duration (upper end of its bucket) below which 'share' of the
+    //     samples of a histogram fall
+    long long Percentile(const std::atomic<unsigned long>* histogram,
+        double share)
+    {
+        unsigned long total = 0;
+        for (unsigned i = 0; i != LockProfiler::buckets; ++i)
+        {
+            total += histogram[i].load(std::memory_order_relaxed);
+        }
+        if (total == 0) return 0;
+        unsigned long seen = 0;
+        for (unsigned i = 0; i != LockProfiler::buckets; ++i)
+        {
+            seen += histogram[i].load(std::memory_order_relaxed);
+            if (seen >= share * total) return 1LL << i;
+        }
+        return 1LL << (LockProfiler::buckets - 1);
+    }
+
+    bool ByWait(const LockProfiler::Stats* lhs, const LockProfiler::Stats* rhs)
+    {
+        return lhs->waitNs_.load(std::memory_order_relaxed) >
+            rhs->waitNs_.load(std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LockProfiler::For
+////////////////////////////////////////////////////////////////////////////////
+
+LockProfiler::Stats& LockProfiler::For(const std::type_info& host,
+    const char* site)
+{
+    std::size_t i = (host.hash_code() ^ std::hash<const char*>()(site))
+        * 0x9E3779B97F4A7C15ULL >> 20;
+    for (std::size_t probes = 0; probes != tableSize; ++probes, ++i)
+    {
+        std::atomic<Stats*>& slot = table[i % tableSize];
+        Stats* pStats = slot.load(std::memory_order_acquire);
+        if (!pStats)
+        {
+            Stats* pNew = new Stats();
+            pNew->host_ = &host;
+            pNew->site_ = site;
+            if (slot.compare_exchange_strong(pStats, pNew,
+                std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return *pNew;
+            }
+            // Somebody else filled the slot first
+            delete pNew;
+        }
+        if (Matches(*pStats, host, site)) return *pStats;
+    }
+    // Table full: lump everything else together
+    return Overflow();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LockProfiler::Reset
+////////////////////////////////////////////////////////////////////////////////
+
+void LockProfiler::Reset()
+{
+    for (std::size_t i = 0; i != tableSize; ++i)
+    {
+        Stats* pStats = table[i].load(std::memory_order_acquire);
+        if (pStats) Clear(*pStats);
+    }
+    Clear(Overflow());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LockProfiler::Dump
+////////////////////////////////////////////////////////////////////////////////
+
+void LockProfiler::Dump(std::ostream& os)
+{
+    std::vector<const Stats*> all;
+    for (std::size_t i = 0; i != tableSize; ++i)
+    {
+        Stats* pStats = table[i].load(std::memory_order_acquire);
+        if (pStats && pStats->acquisitions_.load(std::memory_order_relaxed))
+        {
+            all.push_back(pStats);
+        }
+    }
+    std::sort(all.begin(), all.end(), ByWait);
+    if (Overflow().acquisitions_.load(std::memory_order_relaxed))
+    {
+        all.push_back(&Overflow());
+    }
+
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    os << "Lock contention profile (times in ns; percentiles are upper bounds "
+          "of log2 buckets, over contended acquisitions for the waits)\n"
+       << std::setw(12) << "acquired" << std::setw(11) << "contended"
+       << std::setw(8) << "%"
+       << std::setw(14) << "total wait" << std::setw(10) << "wait p50"
+       << std::setw(10) << "wait p99" << std::setw(14) << "total hold"
+       << std::setw(10) << "hold p50" << std::setw(10) << "hold p99"
+       << "  host [site]\n";
+    for (std::size_t i = 0; i != all.size(); ++i)
+    {
+        const Stats& s = *all[i];
+        const unsigned long acquired =
+            s.acquisitions_.load(std::memory_order_relaxed);
+        const unsigned long contended =
+            s.contended_.load(std::memory_order_relaxed);
+        os << std::setw(12) << acquired << std::setw(11) << contended
+           << std::setw(8) << std::fixed << std::setprecision(2)
+           << 100.0 * contended / acquired
+           << std::setw(14) << s.waitNs_.load(std::memory_order_relaxed)
+           << std::setw(10) << Percentile(s.wait_, 0.5)
+           << std::setw(10) << Percentile(s.wait_, 0.99)
+           << std::setw(14) << s.holdNs_.load(std::memory_order_relaxed)
+           << std::setw(10) << Percentile(s.hold_, 0.5)
+           << std::setw(10) << Percentile(s.hold_, 0.99)
+           << "  ";
+        if (&s == &Overflow())
+        {
+            os << "(other locks, not told apart: the table is full)\n";
+            continue;
+        }
+        os << Demangle(s.host_->name());
+        if (s.site_) os << " [" << s.site_ << ']';
+        os << '\n';
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
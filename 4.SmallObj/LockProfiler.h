@@ -0,0 +1,202 @@
+#ifndef LOCKPROFILER_INC_
+#define LOCKPROFILER_INC_
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <typeinfo>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class LockProfiler
+// Contention statistics for the locks of the ThreadingModel policies, gathered
+//     when Threads.h is compiled with PROFILE_LOCKS defined (link with
+//     LockProfiler.cpp then)
+// Statistics are kept per host type (the Host argument of the policy) and per
+//     call site, as set by LOCK_SITE(); they count acquisitions and contended
+//     acquisitions (those where the lock wasn't free), and keep log2
+//     histograms of the time spent waiting for the lock and holding it
+// Updates are lock-free; Dump can be called at any time
+////////////////////////////////////////////////////////////////////////////////
+
+    class LockProfiler
+    {
+    public:
+        // Bucket i counts durations in [2^(i-1), 2^i) nanoseconds
+        enum { buckets = 40 };
+
+        struct Stats
+        {
+            const std::type_info* host_;
+            const char* site_;
+            std::atomic<unsigned long> acquisitions_;
+            std::atomic<unsigned long> contended_;
+            std::atomic<unsigned long long> waitNs_;
+            std::atomic<unsigned long long> holdNs_;
+            std::atomic<unsigned long> wait_[buckets];
+            std::atomic<unsigned long> hold_[buckets];
+        };
+
+        // What a lock remembers between acquisition and release
+        struct Stamp
+        {
+            long long acquired_;
+            Stats* pStats_;
+        };
+
+        static long long Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        static unsigned Bucket(long long ns)
+        {
+            unsigned i = 0;
+            while (ns > 0 && i != buckets - 1)
+            {
+                ns >>= 1;
+                ++i;
+            }
+            return i;
+        }
+
+        // Statistics of a host and call site (0 for no site), created on
+        //     first use
+        // Once the table is full, the new hosts and sites share one record,
+        //     which Dump lists last
+        static Stats& For(const std::type_info& host, const char* site);
+
+        // Statistics of Host at the current call site; each thread remembers
+        //     the last ones it used for each Host, so the table is only
+        //     searched when the site changes
+        template <class Host>
+        static Stats& For()
+        {
+            static thread_local Stats* pLast = 0;
+            const char* site = CurrentSite();
+            if (!pLast || pLast->site_ != site)
+            {
+                pLast = &For(typeid(Host), site);
+            }
+            return *pLast;
+        }
+
+        template <class Host, class MutexPolicy>
+        static Stamp Lock(MutexPolicy& mtx)
+        {
+            Stamp stamp = { 0, &For<Host>() };
+            if (mtx.TryLock())
+            {
+                stamp.acquired_ = Now();
+                Acquired(*stamp.pStats_, -1);
+            }
+            else
+            {
+                const long long start = Now();
+                mtx.Lock();
+                stamp.acquired_ = Now();
+                Acquired(*stamp.pStats_, stamp.acquired_ - start);
+            }
+            return stamp;
+        }
+
+        template <class MutexPolicy>
+        static void Unlock(MutexPolicy& mtx, const Stamp& stamp)
+        {
+            const long long held = Now() - stamp.acquired_;
+            mtx.Unlock();
+            Released(*stamp.pStats_, held);
+        }
+
+        template <class Host, class RWMutexPolicy>
+        static Stamp ReadLock(RWMutexPolicy& mtx, unsigned& token)
+        {
+            Stamp stamp = { 0, &For<Host>() };
+            if (mtx.TryReadLock(token))
+            {
+                stamp.acquired_ = Now();
+                Acquired(*stamp.pStats_, -1);
+            }
+            else
+            {
+                const long long start = Now();
+                token = mtx.ReadLock();
+                stamp.acquired_ = Now();
+                Acquired(*stamp.pStats_, stamp.acquired_ - start);
+            }
+            return stamp;
+        }
+
+        template <class RWMutexPolicy>
+        static void ReadUnlock(RWMutexPolicy& mtx, unsigned token,
+            const Stamp& stamp)
+        {
+            const long long held = Now() - stamp.acquired_;
+            mtx.ReadUnlock(token);
+            Released(*stamp.pStats_, held);
+        }
+
+        // Writes a table of all locks used so far, by decreasing total wait
+        static void Dump(std::ostream& os);
+
+        // Clears all statistics
+        static void Reset();
+
+        static const char* CurrentSite()
+        { return site_; }
+
+    private:
+        friend class ScopedLockSite;
+
+        // Records an acquisition; waitNs is negative if it wasn't contended
+        static void Acquired(Stats& stats, long long waitNs)
+        {
+            stats.acquisitions_.fetch_add(1, std::memory_order_relaxed);
+            if (waitNs < 0) return;
+            stats.contended_.fetch_add(1, std::memory_order_relaxed);
+            stats.waitNs_.fetch_add(waitNs, std::memory_order_relaxed);
+            stats.wait_[Bucket(waitNs)].fetch_add(1,
+                std::memory_order_relaxed);
+        }
+
+        static void Released(Stats& stats, long long holdNs)
+        {
+            stats.holdNs_.fetch_add(holdNs, std::memory_order_relaxed);
+            stats.hold_[Bucket(holdNs)].fetch_add(1,
+                std::memory_order_relaxed);
+        }
+
+        static thread_local const char* site_;
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class ScopedLockSite
+// Attributes the locks taken in its scope, on this thread, to a call site
+// Use through the LOCK_SITE() macro of Threads.h, which compiles to nothing
+//     unless PROFILE_LOCKS is defined
+////////////////////////////////////////////////////////////////////////////////
+
+    class ScopedLockSite
+    {
+        const char* previous_;
+
+        ScopedLockSite(const ScopedLockSite&);
+        ScopedLockSite& operator=(const ScopedLockSite&);
+
+    public:
+        explicit ScopedLockSite(const char* site)
+            : previous_(LockProfiler::site_)
+        {
+            LockProfiler::site_ = site;
+        }
+
+        ~ScopedLockSite()
+        {
+            LockProfiler::site_ = previous_;
+        }
+    };
+} // namespace Loki
+
+#endif // LOCKPROFILER_INC_
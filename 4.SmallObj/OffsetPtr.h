@@ -0,0 +1,89 @@
+#ifndef OFFSETPTR_INC_
+#define OFFSETPTR_INC_
+
+#include <cstddef>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class template OffsetPtr
+// A pointer that stores the distance between itself and its pointee instead of
+//     an address, so it stays valid when the memory holding both is mapped at
+//     a different address (memory-mapped files, shared memory segments)
+// Copying an OffsetPtr recomputes the distance; never memcpy it to another
+//     location
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class T>
+    class OffsetPtr
+    {
+        // An offset of 1 can't point to a properly aligned T, so it's used as
+        //     the null value (0 would make a pointer to itself null)
+        enum { nullOffset = 1 };
+
+        std::ptrdiff_t offset_;
+
+        void Set(T* p)
+        {
+            offset_ = p
+                ? reinterpret_cast<const char*>(p) -
+                    reinterpret_cast<const char*>(this)
+                : std::ptrdiff_t(nullOffset);
+        }
+
+    public:
+        typedef T ValueType;
+
+        OffsetPtr() : offset_(nullOffset)
+        {}
+
+        OffsetPtr(T* p)
+        { Set(p); }
+
+        OffsetPtr(const OffsetPtr& rhs)
+        { Set(rhs.Get()); }
+
+        OffsetPtr& operator=(const OffsetPtr& rhs)
+        {
+            Set(rhs.Get());
+            return *this;
+        }
+
+        OffsetPtr& operator=(T* p)
+        {
+            Set(p);
+            return *this;
+        }
+
+        T* Get() const
+        {
+            if (offset_ == nullOffset) return 0;
+            return reinterpret_cast<T*>(const_cast<char*>(
+                reinterpret_cast<const char*>(this) + offset_));
+        }
+
+        T* operator->() const
+        { return Get(); }
+
+        T& operator*() const
+        { return *Get(); }
+
+        typedef T* (OffsetPtr::*unspecified_bool_type)() const;
+
+        operator unspecified_bool_type() const
+        {
+            return offset_ == nullOffset ? 0 : &OffsetPtr::Get;
+        }
+
+        bool operator!() const
+        { return offset_ == nullOffset; }
+
+        friend bool operator==(const OffsetPtr& lhs, const OffsetPtr& rhs)
+        { return lhs.Get() == rhs.Get(); }
+
+        friend bool operator!=(const OffsetPtr& lhs, const OffsetPtr& rhs)
+        { return lhs.Get() != rhs.Get(); }
+    };
+} // namespace Loki
+
+#endif // OFFSETPTR_INC_
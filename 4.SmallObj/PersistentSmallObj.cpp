@@ -0,0 +1,403 @@
+#include "PersistentSmallObj.h"
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Loki;
+
+namespace { // anoymous
+
+const char heapMagic[8] = { 'L', 'O', 'K', 'I', 'H', 'E', 'A', 'P' };
+const uint32_t heapVersion = 1;
+
+// Block sizes are rounded up to a multiple of the granularity; size class i
+//     holds blocks of (i + 1) * granularity bytes
+const std::size_t granularity = 8;
+const std::size_t maxSizeClasses = 64;
+
+std::size_t RoundUp(std::size_t n, std::size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+void ThrowSystemError(const char* what)
+{
+    std::string msg(what);
+    msg += ": ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+}
+
+} // anoymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// struct PersistentSmallObjAllocator::Header
+// Lives at offset 0 of the file; all offsets are relative to that address
+////////////////////////////////////////////////////////////////////////////////
+
+struct PersistentSmallObjAllocator::Header
+{
+    struct SizeClass
+    {
+        uint64_t blockSize_;
+        // Head of the list of freed blocks; each free block stores the offset
+        //     of the next one in its first bytes
+        uint64_t freeList_;
+        uint64_t freeBlocks_;
+        // Untouched part of the chunk currently being carved
+        uint64_t cursor_;
+        uint64_t end_;
+    };
+
+    char magic_[8];
+    uint32_t version_;
+    uint32_t headerSize_;
+    uint64_t capacity_;
+    // First byte that doesn't belong to any chunk yet
+    uint64_t top_;
+    uint64_t chunkSize_;
+    uint64_t maxObjectSize_;
+    uint64_t root_;
+    uint32_t numClasses_;
+    // Non-zero only while the file is not mapped by anyone
+    uint32_t clean_;
+    SizeClass classes_[maxSizeClasses];
+    // Covers everything above; only meaningful when clean_ is set
+    uint64_t checksum_;
+
+    uint64_t ComputeChecksum() const
+    {
+        // FNV-1a
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(this);
+        const unsigned char* end =
+            reinterpret_cast<const unsigned char*>(&checksum_);
+        uint64_t hash = 14695981039346656037ULL;
+        for (; p != end; ++p)
+        {
+            hash ^= *p;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::PersistentSmallObjAllocator
+// Maps the file, then either initializes a new heap or checks the existing one
+////////////////////////////////////////////////////////////////////////////////
+
+PersistentSmallObjAllocator::PersistentSmallObjAllocator(
+        const char* path,
+        std::size_t capacity,
+        std::size_t chunkSize,
+        std::size_t maxObjectSize)
+    : fd_(-1), pBase_(0), mappedSize_(0), pHeader_(0), reattached_(false)
+{
+    if (maxObjectSize == 0 || maxObjectSize > maxSizeClasses * granularity)
+    {
+        throw std::invalid_argument("PersistentSmallObjAllocator: "
+            "maxObjectSize must be between 1 and 512");
+    }
+
+    fd_ = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) ThrowSystemError("PersistentSmallObjAllocator: open");
+
+    // Two processes mapping the heap would corrupt each other's free lists;
+    //     the lock goes away with the descriptor, even if the process dies
+    if (::flock(fd_, LOCK_EX | LOCK_NB) != 0)
+    {
+        const int error = errno;
+        ::close(fd_);
+        if (error == EWOULDBLOCK)
+        {
+            throw std::runtime_error("PersistentSmallObjAllocator: "
+                + std::string(path) + " is in use by another process");
+        }
+        errno = error;
+        ThrowSystemError("PersistentSmallObjAllocator: flock");
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        ::close(fd_);
+        ThrowSystemError("PersistentSmallObjAllocator: fstat");
+    }
+
+    if (st.st_size == 0)
+    {
+        Create(capacity, chunkSize, maxObjectSize);
+        return;
+    }
+
+    mappedSize_ = static_cast<std::size_t>(st.st_size);
+    void* p = ::mmap(0, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        ::close(fd_);
+        ThrowSystemError("PersistentSmallObjAllocator: mmap");
+    }
+    pBase_ = static_cast<unsigned char*>(p);
+    pHeader_ = static_cast<Header*>(p);
+
+    // Create writes the magic last: without it, the file is what a Create
+    //     that failed or crashed part-way left behind, and is built again
+    static const char noMagic[sizeof(heapMagic)] = {};
+    if (mappedSize_ >= sizeof(Header) &&
+        std::memcmp(pHeader_->magic_, noMagic, sizeof(noMagic)) == 0)
+    {
+        ::munmap(pBase_, mappedSize_);
+        pBase_ = 0;
+        pHeader_ = 0;
+        Create(capacity, chunkSize, maxObjectSize);
+        return;
+    }
+    reattached_ = true;
+
+    std::string why;
+    if (mappedSize_ < sizeof(Header) || !Check(&why))
+    {
+        ::munmap(pBase_, mappedSize_);
+        ::close(fd_);
+        throw std::runtime_error(
+            "PersistentSmallObjAllocator: inconsistent heap: " + why);
+    }
+    pHeader_->clean_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::Create (internal)
+// Sizes the file and writes an empty heap header, magic last
+// maxObjectSize has been checked by the constructor
+////////////////////////////////////////////////////////////////////////////////
+
+void PersistentSmallObjAllocator::Create(std::size_t capacity,
+    std::size_t chunkSize, std::size_t maxObjectSize)
+{
+    maxObjectSize = RoundUp(maxObjectSize, granularity);
+    if (chunkSize < maxObjectSize) chunkSize = maxObjectSize;
+
+    const std::size_t headerSize = RoundUp(sizeof(Header), 64);
+    if (capacity < headerSize + chunkSize) capacity = headerSize + chunkSize;
+    capacity = RoundUp(capacity, static_cast<std::size_t>(::getpagesize()));
+
+    if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0)
+    {
+        ::close(fd_);
+        ThrowSystemError("PersistentSmallObjAllocator: ftruncate");
+    }
+    void* p = ::mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        ::close(fd_);
+        ThrowSystemError("PersistentSmallObjAllocator: mmap");
+    }
+    pBase_ = static_cast<unsigned char*>(p);
+    mappedSize_ = capacity;
+    pHeader_ = static_cast<Header*>(p);
+
+    std::memset(pHeader_, 0, sizeof(Header));
+    pHeader_->version_ = heapVersion;
+    pHeader_->headerSize_ = static_cast<uint32_t>(headerSize);
+    pHeader_->capacity_ = capacity;
+    pHeader_->top_ = headerSize;
+    pHeader_->chunkSize_ = chunkSize;
+    pHeader_->maxObjectSize_ = maxObjectSize;
+    pHeader_->numClasses_ =
+        static_cast<uint32_t>(maxObjectSize / granularity);
+    for (uint32_t i = 0; i != pHeader_->numClasses_; ++i)
+    {
+        pHeader_->classes_[i].blockSize_ = (i + 1) * granularity;
+    }
+    std::memcpy(pHeader_->magic_, heapMagic, sizeof(heapMagic));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::~PersistentSmallObjAllocator
+////////////////////////////////////////////////////////////////////////////////
+
+PersistentSmallObjAllocator::~PersistentSmallObjAllocator()
+{
+    Close();
+}
+
+void PersistentSmallObjAllocator::Close()
+{
+    if (!pBase_) return;
+
+    pHeader_->clean_ = 1;
+    pHeader_->checksum_ = pHeader_->ComputeChecksum();
+    ::msync(pBase_, mappedSize_, MS_SYNC);
+    ::munmap(pBase_, mappedSize_);
+    ::close(fd_);
+    pBase_ = 0;
+    pHeader_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::Flush
+////////////////////////////////////////////////////////////////////////////////
+
+void PersistentSmallObjAllocator::Flush()
+{
+    if (::msync(pBase_, mappedSize_, MS_SYNC) != 0)
+    {
+        ThrowSystemError("PersistentSmallObjAllocator: msync");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::Allocate
+// Pops a block off the size class' free list or carves one out of its current
+//     chunk; a new chunk is taken from the unused end of the file as needed
+////////////////////////////////////////////////////////////////////////////////
+
+void* PersistentSmallObjAllocator::Allocate(std::size_t numBytes)
+{
+    if (numBytes == 0) numBytes = 1;
+    if (numBytes > pHeader_->maxObjectSize_) throw std::bad_alloc();
+
+    Header::SizeClass& sc =
+        pHeader_->classes_[(numBytes + granularity - 1) / granularity - 1];
+
+    if (sc.freeList_)
+    {
+        unsigned char* pResult = pBase_ + sc.freeList_;
+        std::memcpy(&sc.freeList_, pResult, sizeof(sc.freeList_));
+        --sc.freeBlocks_;
+        return pResult;
+    }
+
+    if (sc.cursor_ == sc.end_)
+    {
+        const uint64_t chunkLength =
+            pHeader_->chunkSize_ / sc.blockSize_ * sc.blockSize_;
+        if (pHeader_->capacity_ - pHeader_->top_ < chunkLength)
+        {
+            throw std::bad_alloc();
+        }
+        sc.cursor_ = pHeader_->top_;
+        sc.end_ = sc.cursor_ + chunkLength;
+        pHeader_->top_ = sc.end_;
+    }
+
+    unsigned char* pResult = pBase_ + sc.cursor_;
+    sc.cursor_ += sc.blockSize_;
+    return pResult;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::Deallocate
+// Deallocates memory previously allocated with Allocate
+// (undefined behavior if you pass any other pointer)
+////////////////////////////////////////////////////////////////////////////////
+
+void PersistentSmallObjAllocator::Deallocate(void* p, std::size_t numBytes)
+{
+    if (numBytes == 0) numBytes = 1;
+    assert(numBytes <= pHeader_->maxObjectSize_);
+
+    unsigned char* toRelease = static_cast<unsigned char*>(p);
+    assert(toRelease >= pBase_ + pHeader_->headerSize_);
+    assert(toRelease < pBase_ + pHeader_->top_);
+
+    Header::SizeClass& sc =
+        pHeader_->classes_[(numBytes + granularity - 1) / granularity - 1];
+    std::memcpy(toRelease, &sc.freeList_, sizeof(sc.freeList_));
+    sc.freeList_ = static_cast<uint64_t>(toRelease - pBase_);
+    ++sc.freeBlocks_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::Root/SetRoot
+////////////////////////////////////////////////////////////////////////////////
+
+void* PersistentSmallObjAllocator::Root() const
+{
+    return pHeader_->root_ ? pBase_ + pHeader_->root_ : 0;
+}
+
+void PersistentSmallObjAllocator::SetRoot(void* p)
+{
+    pHeader_->root_ = p
+        ? static_cast<uint64_t>(static_cast<unsigned char*>(p) - pBase_)
+        : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentSmallObjAllocator::Check
+// Consistency check run when reattaching
+////////////////////////////////////////////////////////////////////////////////
+
+bool PersistentSmallObjAllocator::Check(std::string* why) const
+{
+    const Header& h = *pHeader_;
+    const char* error = 0;
+
+    if (std::memcmp(h.magic_, heapMagic, sizeof(heapMagic)) != 0)
+        error = "bad magic";
+    else if (h.version_ != heapVersion)
+        error = "unsupported version";
+    else if (h.headerSize_ < sizeof(Header) || h.headerSize_ % granularity)
+        error = "bad header size";
+    else if (h.capacity_ != mappedSize_)
+        error = "capacity doesn't match the file size";
+    else if (h.clean_ && h.checksum_ != h.ComputeChecksum())
+        error = "header checksum mismatch";
+    else if (h.top_ < h.headerSize_ || h.top_ > h.capacity_)
+        error = "top out of range";
+    else if (h.maxObjectSize_ == 0 || h.maxObjectSize_ % granularity ||
+        h.maxObjectSize_ > maxSizeClasses * granularity ||
+        h.numClasses_ != h.maxObjectSize_ / granularity)
+        error = "bad size classes";
+    else if (h.chunkSize_ < h.maxObjectSize_)
+        error = "bad chunk size";
+    else if (h.root_ && (h.root_ < h.headerSize_ || h.root_ >= h.top_))
+        error = "root out of range";
+
+    for (uint32_t i = 0; !error && i != h.numClasses_; ++i)
+    {
+        const Header::SizeClass& sc = h.classes_[i];
+        if (sc.blockSize_ != (i + 1) * granularity)
+        {
+            error = "bad block size";
+            break;
+        }
+        if (sc.cursor_ > sc.end_ || sc.end_ > h.top_ ||
+            (sc.end_ && sc.cursor_ < h.headerSize_))
+        {
+            error = "current chunk out of range";
+            break;
+        }
+        // Walk the free list; the count bound also catches cycles
+        uint64_t count = 0;
+        uint64_t offset = sc.freeList_;
+        for (; offset && count <= sc.freeBlocks_; ++count)
+        {
+            if (offset < h.headerSize_ || offset + sc.blockSize_ > h.top_ ||
+                offset % granularity)
+            {
+                error = "free block out of range";
+                break;
+            }
+            std::memcpy(&offset, pBase_ + offset, sizeof(offset));
+        }
+        if (!error && count != sc.freeBlocks_)
+        {
+            error = "free list length mismatch";
+        }
+    }
+
+    if (error && why) *why = error;
+    return !error;
+}
@@ -0,0 +1,84 @@
+#ifndef PERSISTENTSMALLOBJ_INC_
+#define PERSISTENTSMALLOBJ_INC_
+
+#include "SmallObj.h"
+#include "OffsetPtr.h"
+#include <cstddef>
+#include <string>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class PersistentSmallObjAllocator
+// File-backed variant of SmallObjAllocator
+// All chunks live inside a memory-mapped file, so a restarted process can
+//     reattach to the heap and find its objects where it left them
+// The file starts with a header that records the size classes, their free
+//     lists and a root object; everything is addressed by offsets from the
+//     start of the file, so the mapping address may change between runs
+// Objects stored in the heap must link to each other through OffsetPtr (or
+//     offsets), never through raw pointers
+// Objects larger than the maximum small object size can't be allocated
+////////////////////////////////////////////////////////////////////////////////
+
+    class PersistentSmallObjAllocator
+    {
+    public:
+        // Opens the heap stored in 'path' or, if the file doesn't exist, is
+        //     empty or was left behind by a creation that didn't complete,
+        //     creates a heap of 'capacity' bytes
+        // When reattaching, 'capacity', 'chunkSize' and 'maxObjectSize' are
+        //     taken from the file and the arguments are ignored
+        // Takes an exclusive lock on the file for the lifetime of the object
+        // Throws std::runtime_error if the file is locked by another process
+        //     (or another allocator), can't be mapped or fails the
+        //     consistency check
+        // Throws std::invalid_argument if 'maxObjectSize' is 0 or above 512
+        //     (64 size classes of 8 bytes)
+        PersistentSmallObjAllocator(
+            const char* path,
+            std::size_t capacity,
+            std::size_t chunkSize = DEFAULT_CHUNK_SIZE,
+            std::size_t maxObjectSize = MAX_SMALL_OBJECT_SIZE);
+        // Flushes the heap, marks it as cleanly closed and unmaps it
+        ~PersistentSmallObjAllocator();
+
+        void* Allocate(std::size_t numBytes);
+        void Deallocate(void* p, std::size_t numBytes);
+
+        // The root object is the entry point to the object graph after a
+        //     reattach
+        void* Root() const;
+        void SetRoot(void* p);
+
+        // Returns true if the heap was found in the file rather than created
+        bool Reattached() const
+        { return reattached_; }
+
+        // Validates the header and walks every free list; on failure returns
+        //     false and, if 'why' is non-null, stores a description in it
+        bool Check(std::string* why = 0) const;
+
+        // Writes the mapped memory back to the file
+        void Flush();
+
+    private:
+        PersistentSmallObjAllocator(const PersistentSmallObjAllocator&);
+        PersistentSmallObjAllocator& operator=(
+            const PersistentSmallObjAllocator&);
+
+        struct Header;
+
+        void Create(std::size_t capacity, std::size_t chunkSize,
+            std::size_t maxObjectSize);
+        void Close();
+
+        int fd_;
+        unsigned char* pBase_;
+        std::size_t mappedSize_;
+        Header* pHeader_;
+        bool reattached_;
+    };
+} // namespace Loki
+
+#endif // PERSISTENTSMALLOBJ_INC_
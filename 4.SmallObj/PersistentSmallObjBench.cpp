@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// Compares reattaching to a PersistentSmallObjAllocator heap with rebuilding
+//     the same object graph from scratch
+// Build: g++ -O2 PersistentSmallObjBench.cpp PersistentSmallObj.cpp
+// Usage: ./a.out [nodes] [heap file]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "PersistentSmallObj.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+
+using namespace Loki;
+
+namespace
+{
+    // Binary search tree node, linked through offsets
+    struct Node
+    {
+        unsigned long key_;
+        OffsetPtr<Node> left_;
+        OffsetPtr<Node> right_;
+    };
+
+    struct Root
+    {
+        unsigned long count_;
+        OffsetPtr<Node> tree_;
+    };
+
+    double Seconds(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - since).count();
+    }
+
+    void Build(PersistentSmallObjAllocator& heap, unsigned long nodes)
+    {
+        Root* pRoot = new(heap.Allocate(sizeof(Root))) Root;
+        pRoot->count_ = 0;
+        heap.SetRoot(pRoot);
+
+        unsigned long key = 1;
+        for (unsigned long i = 0; i != nodes; ++i)
+        {
+            key = key * 6364136223846793005UL + 1442695040888963407UL;
+            Node* pNode = new(heap.Allocate(sizeof(Node))) Node;
+            pNode->key_ = key;
+
+            OffsetPtr<Node>* pLink = &pRoot->tree_;
+            while (*pLink)
+            {
+                pLink = key < (*pLink)->key_
+                    ? &(*pLink)->left_ : &(*pLink)->right_;
+            }
+            *pLink = pNode;
+            ++pRoot->count_;
+        }
+    }
+
+    unsigned long Count(const Node* pNode)
+    {
+        if (!pNode) return 0;
+        return 1 + Count(pNode->left_.Get()) + Count(pNode->right_.Get());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned long nodes = argc > 1 ? std::strtoul(argv[1], 0, 10)
+        : 1000000;
+    const char* path = argc > 2 ? argv[2] : "PersistentSmallObjBench.heap";
+    const std::size_t capacity = nodes * sizeof(Node) * 2 + (1 << 20);
+
+    ::unlink(path);
+
+    // Creating the file and writing it back on close are timed apart, as
+    //     neither is part of building the graph
+    std::chrono::steady_clock::time_point start;
+    double rebuild = 0;
+    {
+        PersistentSmallObjAllocator heap(path, capacity);
+        start = std::chrono::steady_clock::now();
+        Build(heap, nodes);
+        rebuild = Seconds(start);
+        start = std::chrono::steady_clock::now();
+    }
+    const double sync = Seconds(start);
+
+    unsigned long found = 0;
+    double reattach = 0;
+    {
+        start = std::chrono::steady_clock::now();
+        PersistentSmallObjAllocator heap(path, capacity);
+        const Root* pRoot = static_cast<const Root*>(heap.Root());
+        found = pRoot ? pRoot->count_ : 0;
+        reattach = Seconds(start);
+    }
+
+    unsigned long walked = 0;
+    double reattachAndWalk = 0;
+    {
+        start = std::chrono::steady_clock::now();
+        PersistentSmallObjAllocator heap(path, capacity);
+        const Root* pRoot = static_cast<const Root*>(heap.Root());
+        walked = Count(pRoot->tree_.Get());
+        reattachAndWalk = Seconds(start);
+    }
+
+    std::printf("nodes:                   %lu\n", nodes);
+    std::printf("rebuild:                 %10.3f ms\n", rebuild * 1e3);
+    std::printf("sync on close:           %10.3f ms\n", sync * 1e3);
+    std::printf("reattach:                %10.3f ms (%lu nodes)\n",
+        reattach * 1e3, found);
+    std::printf("reattach + full walk:    %10.3f ms (%lu nodes)\n",
+        reattachAndWalk * 1e3, walked);
+
+    ::unlink(path);
+    return found == nodes && walked == nodes ? 0 : 1;
+}
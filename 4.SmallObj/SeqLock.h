@@ -0,0 +1,138 @@
+#ifndef SEQLOCK_INC_
+#define SEQLOCK_INC_
+
+#include "Threads.h"
+#include <atomic>
+#include <cstring>
+#include <sched.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class template SeqLocked
+// Holds a small, trivially copyable T (a quote, a snapshot of statistics...)
+//     that a few writers update and many readers copy out
+// Readers never block anybody: they copy the value between two loads of a
+//     sequence number, and retry if a writer was at work meanwhile
+// Writers bump the sequence number to odd, store, then bump it to even again;
+//     concurrent writers are serialized by spinning on the sequence number, so
+//     updates are expected to be short
+// The value is kept as relaxed atomic words, so that a torn copy (which is
+//     discarded anyway) is not a data race
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class T>
+    class SeqLocked
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "SeqLocked needs a trivially copyable type");
+
+        typedef uint64_t Word;
+        enum { words = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word) };
+
+        alignas(64) std::atomic<unsigned> seq_;
+        std::atomic<Word> data_[words];
+
+        SeqLocked(const SeqLocked&);
+        SeqLocked& operator=(const SeqLocked&);
+
+        unsigned BeginWrite()
+        {
+            unsigned seq = seq_.load(std::memory_order_relaxed);
+            while ((seq & 1) || !seq_.compare_exchange_weak(seq, seq + 1,
+                std::memory_order_relaxed, std::memory_order_relaxed))
+            {
+                Private::CpuRelax();
+                seq = seq_.load(std::memory_order_relaxed);
+            }
+            // Orders the odd sequence number before the stores of the value
+            std::atomic_thread_fence(std::memory_order_release);
+            return seq + 2;
+        }
+
+        void Write(const T& value)
+        {
+            Word buffer[words] = {};
+            std::memcpy(buffer, &value, sizeof(T));
+            for (unsigned i = 0; i != words; ++i)
+            {
+                data_[i].store(buffer[i], std::memory_order_relaxed);
+            }
+        }
+
+        void Read(T& result) const
+        {
+            Word buffer[words];
+            for (unsigned i = 0; i != words; ++i)
+            {
+                buffer[i] = data_[i].load(std::memory_order_relaxed);
+            }
+            std::memcpy(&result, buffer, sizeof(T));
+        }
+
+    public:
+        SeqLocked() : seq_(0)
+        { Write(T()); }
+
+        explicit SeqLocked(const T& value) : seq_(0)
+        { Write(value); }
+
+        // Makes a single attempt at copying the value; fails if a writer
+        //     interfered
+        bool TryLoad(T& result) const
+        {
+            const unsigned seq = seq_.load(std::memory_order_acquire);
+            if (seq & 1) return false;
+            Read(result);
+            // Orders the loads of the value before the second check
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return seq_.load(std::memory_order_relaxed) == seq;
+        }
+
+        void Load(T& result) const
+        {
+            // A writer preempted halfway through would keep us spinning for
+            //     a whole time slice, hence the yield
+            for (unsigned attempts = 1; !TryLoad(result); ++attempts)
+            {
+                if (attempts % 64 == 0) ::sched_yield();
+                else Private::CpuRelax();
+            }
+        }
+
+        T Load() const
+        {
+            T result;
+            Load(result);
+            return result;
+        }
+
+        void Store(const T& value)
+        {
+            const unsigned seq = BeginWrite();
+            Write(value);
+            seq_.store(seq, std::memory_order_release);
+        }
+
+        // Applies fun to a copy of the current value and stores the result,
+        //     atomically with respect to other writers
+        template <class Fun>
+        void Update(Fun fun)
+        {
+            const unsigned seq = BeginWrite();
+            T value;
+            Read(value);
+            fun(value);
+            Write(value);
+            seq_.store(seq, std::memory_order_release);
+        }
+
+        // Incremented twice by every update
+        unsigned Version() const
+        { return seq_.load(std::memory_order_acquire); }
+    };
+} // namespace Loki
+
+#endif // SEQLOCK_INC_
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+// Snapshot reads of a small record: SeqLocked<T> versus copying it under the
+//     Lock of ObjectLevelLockable, with no writer and with a writer updating
+//     the record continuously
+// Every read checks the record's invariant, so torn reads would show up
+// Build: g++ -O2 -pthread SeqLockBench.cpp
+// Usage: ./a.out [reads per thread]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SeqLock.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace Loki;
+
+namespace
+{
+    // A quote; ask_ == bid_ + 1 and askSize_ == bidSize_ + 1 at all times
+    struct Quote
+    {
+        double bid_;
+        double ask_;
+        long bidSize_;
+        long askSize_;
+        long seq_;
+    };
+
+    Quote MakeQuote(long seq)
+    {
+        Quote q = { double(seq), double(seq) + 1, seq, seq + 1, seq };
+        return q;
+    }
+
+    bool Consistent(const Quote& q)
+    {
+        return q.ask_ == q.bid_ + 1 && q.askSize_ == q.bidSize_ + 1;
+    }
+
+    class SeqLockedQuote
+    {
+        SeqLocked<Quote> quote_;
+
+    public:
+        SeqLockedQuote() : quote_(MakeQuote(0))
+        {}
+
+        Quote Read() const
+        { return quote_.Load(); }
+
+        void Write(const Quote& q)
+        { quote_.Store(q); }
+    };
+
+    class LockedQuote : public ObjectLevelLockable<LockedQuote>
+    {
+        Quote quote_;
+
+    public:
+        LockedQuote() : quote_(MakeQuote(0))
+        {}
+
+        Quote Read() const
+        {
+            Lock lock(*this);
+            (void)lock;
+            return quote_;
+        }
+
+        void Write(const Quote& q)
+        {
+            Lock lock(*this);
+            (void)lock;
+            quote_ = q;
+        }
+    };
+
+    struct Result
+    {
+        double readNs_;
+        double writesPerSecond_;
+        long torn_;
+    };
+
+    // 'readers' threads read 'reads' times each, while (if 'writer') another
+    //     thread keeps writing until they're done
+    template <class Holder>
+    Result Run(unsigned readers, unsigned long reads, bool writer)
+    {
+        Holder holder;
+        std::atomic<bool> done(false);
+        std::atomic<long> torn(0);
+        long writes = 0;
+
+        std::thread writerThread;
+        if (writer)
+        {
+            writerThread = std::thread([&]()
+            {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    holder.Write(MakeQuote(++writes));
+                }
+            });
+        }
+
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i != readers; ++i)
+        {
+            pool.push_back(std::thread([&]()
+            {
+                long bad = 0;
+                for (unsigned long n = 0; n != reads; ++n)
+                {
+                    if (!Consistent(holder.Read())) ++bad;
+                }
+                torn += bad;
+            }));
+        }
+        for (unsigned i = 0; i != readers; ++i) pool[i].join();
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        done.store(true);
+        if (writer) writerThread.join();
+
+        Result result = { seconds * 1e9 / reads, writes / seconds,
+            torn.load() };
+        return result;
+    }
+
+    template <class Holder>
+    void Row(const char* name, unsigned readers, unsigned long reads,
+        bool writer)
+    {
+        Result r = Run<Holder>(readers, reads, writer);
+        std::printf("%-12s %8u %8s %12.2f %14.0f %8ld\n", name, readers,
+            writer ? "yes" : "no", r.readNs_, r.writesPerSecond_, r.torn_);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned long reads = argc > 1
+        ? std::strtoul(argv[1], 0, 10) : 10000000;
+    unsigned readers = std::thread::hardware_concurrency();
+    if (readers == 0) readers = 2;
+    if (readers > 1) --readers; // leave a core to the writer
+
+    std::printf("%-12s %8s %8s %12s %14s %8s\n", "holder", "readers",
+        "writer", "ns/read", "writes/s", "torn");
+    Row<SeqLockedQuote>("SeqLocked", 1, reads, false);
+    Row<LockedQuote>("Lock", 1, reads, false);
+    Row<SeqLockedQuote>("SeqLocked", readers, reads, true);
+    Row<LockedQuote>("Lock", readers, reads, true);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef SHARDEDCOUNTER_INC_
+#define SHARDEDCOUNTER_INC_
+
+#include "Threads.h"
+#include <atomic>
+
+#ifndef SHARDED_COUNTER_SHARDS
+#define SHARDED_COUNTER_SHARDS 64
+#endif
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class template ShardedCounter
+// Statistics counter that doesn't bounce a cache line between the cores that
+//     bump it: each processor adds into a shard of its own (one cache line
+//     each), and reads add the shards up
+// Updates are relaxed and cost one uncontended atomic addition; a read sees
+//     every update that happened before it, but concurrent updates may or may
+//     not be included, so it's a statistic rather than a synchronization device
+// Takes 'shards' cache lines; the default is SHARDED_COUNTER_SHARDS
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class T = long, unsigned shards = SHARDED_COUNTER_SHARDS>
+    class ShardedCounter
+    {
+        struct alignas(64) Shard
+        {
+            std::atomic<T> value_;
+        };
+
+        Shard shards_[shards];
+
+        ShardedCounter(const ShardedCounter&);
+        ShardedCounter& operator=(const ShardedCounter&);
+
+    public:
+        constexpr ShardedCounter() : shards_()
+        {}
+
+        void Add(T n)
+        {
+            shards_[Private::CurrentSlot(shards)].value_.fetch_add(n,
+                std::memory_order_relaxed);
+        }
+
+        void Subtract(T n)
+        {
+            shards_[Private::CurrentSlot(shards)].value_.fetch_sub(n,
+                std::memory_order_relaxed);
+        }
+
+        void Increment()
+        { Add(1); }
+
+        void Decrement()
+        { Subtract(1); }
+
+        T Load() const
+        {
+            T sum = 0;
+            for (unsigned i = 0; i != shards; ++i)
+            {
+                sum += shards_[i].value_.load(std::memory_order_relaxed);
+            }
+            return sum;
+        }
+
+        // Updates made concurrently with a Reset may survive it
+        void Reset()
+        {
+            for (unsigned i = 0; i != shards; ++i)
+            {
+                shards_[i].value_.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+} // namespace Loki
+
+#endif // SHARDEDCOUNTER_INC_
@@ -0,0 +1,327 @@
+#include "SharedSmallObj.h"
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Loki;
+
+namespace { // anoymous
+
+const char segmentMagic[8] = { 'L', 'O', 'K', 'I', 'S', 'H', 'M', 0 };
+
+// Block sizes are rounded up to a multiple of the granularity; size class i
+//     holds blocks of (i + 1) * granularity bytes
+const std::size_t granularity = 8;
+const std::size_t maxSizeClasses = 64;
+
+// A free list head packs the offset of the first block with a tag that is
+//     bumped on every update, which defeats the ABA problem
+const unsigned offsetBits = 40;
+const uint64_t offsetMask = (uint64_t(1) << offsetBits) - 1;
+
+// How long a process opening a segment waits for its creator to initialize it
+const unsigned maxInitWaitMs = 5000;
+
+std::size_t RoundUp(std::size_t n, std::size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+void ThrowSystemError(const char* what)
+{
+    std::string msg(what);
+    msg += ": ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+}
+
+uint64_t NextOf(const unsigned char* pBlock)
+{
+    return __atomic_load_n(reinterpret_cast<const uint64_t*>(pBlock),
+        __ATOMIC_RELAXED);
+}
+
+void SetNextOf(unsigned char* pBlock, uint64_t next)
+{
+    __atomic_store_n(reinterpret_cast<uint64_t*>(pBlock), next,
+        __ATOMIC_RELAXED);
+}
+
+} // anoymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// struct SharedSmallObjAllocator::Header
+// Lives at offset 0 of the segment
+// Only address-free (lock-free) atomics may be used here, since every process
+//     maps the segment at a different address
+////////////////////////////////////////////////////////////////////////////////
+
+#if ATOMIC_LLONG_LOCK_FREE != 2 || ATOMIC_INT_LOCK_FREE != 2
+#error SharedSmallObjAllocator requires lock-free 32- and 64-bit atomics
+#endif
+
+struct SharedSmallObjAllocator::Header
+{
+    // Padded to a cache line so that size classes don't false-share
+    struct alignas(64) SizeClass
+    {
+        std::atomic<uint64_t> freeList_;
+        uint64_t blockSize_;
+    };
+
+    char magic_[8];
+    std::atomic<uint32_t> ready_;
+    uint32_t numClasses_;
+    uint64_t capacity_;
+    uint64_t headerSize_;
+    uint64_t chunkSize_;
+    uint64_t maxObjectSize_;
+    // First byte that doesn't belong to any chunk yet
+    std::atomic<uint64_t> top_;
+    SizeClass classes_[maxSizeClasses];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::SharedSmallObjAllocator
+// The process that manages to create the segment initializes it; the others
+//     wait until it's marked ready
+////////////////////////////////////////////////////////////////////////////////
+
+SharedSmallObjAllocator::SharedSmallObjAllocator(
+        const char* name,
+        std::size_t capacity,
+        std::size_t chunkSize,
+        std::size_t maxObjectSize)
+    : pBase_(0), mappedSize_(0), pHeader_(0)
+{
+    // Checked before the segment exists, since every process would use it
+    if (maxObjectSize == 0 || maxObjectSize > maxSizeClasses * granularity)
+    {
+        throw std::invalid_argument("SharedSmallObjAllocator: "
+            "maxObjectSize must be between 1 and 512");
+    }
+    maxObjectSize = RoundUp(maxObjectSize, granularity);
+    if (chunkSize < maxObjectSize) chunkSize = maxObjectSize;
+
+    const std::size_t headerSize = RoundUp(sizeof(Header), 64);
+    if (capacity < headerSize + chunkSize) capacity = headerSize + chunkSize;
+    capacity = RoundUp(capacity, static_cast<std::size_t>(::getpagesize()));
+    if (capacity > offsetMask)
+    {
+        throw std::invalid_argument("SharedSmallObjAllocator: "
+            "capacity must fit in 40 bits");
+    }
+
+    int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+    {
+        if (::ftruncate(fd, static_cast<off_t>(capacity)) != 0)
+        {
+            ::close(fd);
+            ::shm_unlink(name);
+            ThrowSystemError("SharedSmallObjAllocator: ftruncate");
+        }
+        Map(fd, capacity);
+        Initialize(capacity, chunkSize, maxObjectSize);
+        return;
+    }
+    if (errno != EEXIST) ThrowSystemError("SharedSmallObjAllocator: shm_open");
+
+    fd = ::shm_open(name, O_RDWR, 0600);
+    if (fd < 0) ThrowSystemError("SharedSmallObjAllocator: shm_open");
+
+    // The creator may not have sized the segment yet
+    struct stat st;
+    for (unsigned waited = 0; ; ++waited)
+    {
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            ThrowSystemError("SharedSmallObjAllocator: fstat");
+        }
+        if (st.st_size != 0) break;
+        if (waited == maxInitWaitMs)
+        {
+            ::close(fd);
+            throw std::runtime_error(
+                "SharedSmallObjAllocator: segment never got initialized");
+        }
+        ::usleep(1000);
+    }
+    Map(fd, static_cast<std::size_t>(st.st_size));
+
+    for (unsigned waited = 0;
+        !pHeader_->ready_.load(std::memory_order_acquire); ++waited)
+    {
+        if (waited == maxInitWaitMs)
+        {
+            ::munmap(pBase_, mappedSize_);
+            throw std::runtime_error(
+                "SharedSmallObjAllocator: segment never got initialized");
+        }
+        ::usleep(1000);
+    }
+    if (std::memcmp(pHeader_->magic_, segmentMagic, sizeof(segmentMagic)) ||
+        pHeader_->capacity_ != mappedSize_)
+    {
+        ::munmap(pBase_, mappedSize_);
+        throw std::runtime_error("SharedSmallObjAllocator: bad segment");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::Map (internal)
+// Maps the whole segment and closes the descriptor, which is no longer needed
+////////////////////////////////////////////////////////////////////////////////
+
+void SharedSmallObjAllocator::Map(int fd, std::size_t size)
+{
+    void* p = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) ThrowSystemError("SharedSmallObjAllocator: mmap");
+
+    pBase_ = static_cast<unsigned char*>(p);
+    mappedSize_ = size;
+    pHeader_ = static_cast<Header*>(p);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::Initialize (internal)
+// Builds an empty header in a freshly created (zero-filled) segment
+////////////////////////////////////////////////////////////////////////////////
+
+void SharedSmallObjAllocator::Initialize(std::size_t capacity,
+    std::size_t chunkSize, std::size_t maxObjectSize)
+{
+    Header* pHeader = new(pBase_) Header;
+    std::memcpy(pHeader->magic_, segmentMagic, sizeof(segmentMagic));
+    pHeader->numClasses_ = static_cast<uint32_t>(maxObjectSize / granularity);
+    pHeader->capacity_ = capacity;
+    pHeader->headerSize_ = RoundUp(sizeof(Header), 64);
+    pHeader->chunkSize_ = chunkSize;
+    pHeader->maxObjectSize_ = maxObjectSize;
+    pHeader->top_.store(pHeader->headerSize_, std::memory_order_relaxed);
+    for (uint32_t i = 0; i != maxSizeClasses; ++i)
+    {
+        pHeader->classes_[i].freeList_.store(0, std::memory_order_relaxed);
+        pHeader->classes_[i].blockSize_ = (i + 1) * granularity;
+    }
+    pHeader->ready_.store(1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::~SharedSmallObjAllocator
+////////////////////////////////////////////////////////////////////////////////
+
+SharedSmallObjAllocator::~SharedSmallObjAllocator()
+{
+    ::munmap(pBase_, mappedSize_);
+}
+
+void SharedSmallObjAllocator::Unlink(const char* name)
+{
+    ::shm_unlink(name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::Push (internal)
+// Pushes the chain of blocks first..last (already linked together) onto the
+//     free list of a size class
+////////////////////////////////////////////////////////////////////////////////
+
+void SharedSmallObjAllocator::Push(std::size_t sizeClass, std::size_t first,
+    std::size_t last)
+{
+    std::atomic<uint64_t>& freeList = pHeader_->classes_[sizeClass].freeList_;
+    uint64_t head = freeList.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do
+    {
+        SetNextOf(pBase_ + last, head & offsetMask);
+        newHead = (((head >> offsetBits) + 1) << offsetBits) | first;
+    }
+    while (!freeList.compare_exchange_weak(head, newHead,
+        std::memory_order_release, std::memory_order_relaxed));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::Allocate
+// Pops a block off the size class' free list; when the list is empty, carves a
+//     new chunk out of the segment, keeps its first block and pushes the rest
+////////////////////////////////////////////////////////////////////////////////
+
+void* SharedSmallObjAllocator::Allocate(std::size_t numBytes)
+{
+    if (numBytes == 0) numBytes = 1;
+    if (numBytes > pHeader_->maxObjectSize_) throw std::bad_alloc();
+
+    const std::size_t sizeClass = (numBytes + granularity - 1) / granularity - 1;
+    Header::SizeClass& sc = pHeader_->classes_[sizeClass];
+
+    uint64_t head = sc.freeList_.load(std::memory_order_acquire);
+    while (head & offsetMask)
+    {
+        // The block may be popped and reused by someone else meanwhile; then
+        //     'next' is garbage but the tag makes the exchange fail
+        const uint64_t offset = head & offsetMask;
+        const uint64_t next = NextOf(pBase_ + offset);
+        const uint64_t newHead =
+            (((head >> offsetBits) + 1) << offsetBits) | next;
+        if (sc.freeList_.compare_exchange_weak(head, newHead,
+            std::memory_order_acquire, std::memory_order_acquire))
+        {
+            return pBase_ + offset;
+        }
+    }
+
+    const uint64_t blockSize = sc.blockSize_;
+    const uint64_t chunkLength =
+        pHeader_->chunkSize_ / blockSize * blockSize;
+    const uint64_t start =
+        pHeader_->top_.fetch_add(chunkLength, std::memory_order_relaxed);
+    if (start + chunkLength > pHeader_->capacity_)
+    {
+        // top_ stays past the end; every later refill fails as well
+        throw std::bad_alloc();
+    }
+
+    const uint64_t last = start + chunkLength - blockSize;
+    if (last != start)
+    {
+        for (uint64_t offset = start + blockSize; offset != last;
+            offset += blockSize)
+        {
+            SetNextOf(pBase_ + offset, offset + blockSize);
+        }
+        Push(sizeClass, start + blockSize, last);
+    }
+    return pBase_ + start;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SharedSmallObjAllocator::Deallocate
+// Deallocates memory previously allocated with Allocate by any process
+// (undefined behavior if you pass any other pointer)
+////////////////////////////////////////////////////////////////////////////////
+
+void SharedSmallObjAllocator::Deallocate(void* p, std::size_t numBytes)
+{
+    if (numBytes == 0) numBytes = 1;
+    assert(numBytes <= pHeader_->maxObjectSize_);
+
+    const std::size_t offset = ToOffset(p);
+    assert(offset >= pHeader_->headerSize_);
+    assert(offset < pHeader_->top_.load(std::memory_order_relaxed));
+
+    Push((numBytes + granularity - 1) / granularity - 1, offset, offset);
+}
@@ -0,0 +1,73 @@
+#ifndef SHAREDSMALLOBJ_INC_
+#define SHAREDSMALLOBJ_INC_
+
+#include "SmallObj.h"
+#include <cstddef>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class SharedSmallObjAllocator
+// Variant of SmallObjAllocator that lives in a POSIX shared memory segment
+// Cooperating processes open the same segment by name; a block allocated by one
+//     process can be read and deallocated by any other, so small messages are
+//     handed off by passing their offset instead of copying them
+// Every size class keeps a lock-free free list made of process-shared atomics,
+//     so no lock is needed (the segment must not be opened by threads that
+//     expect the ThreadingModel's locks to be taken)
+// Objects larger than the maximum small object size can't be allocated
+////////////////////////////////////////////////////////////////////////////////
+
+    class SharedSmallObjAllocator
+    {
+    public:
+        // Opens the segment 'name' (in the shm_open sense, e.g. "/myapp"),
+        //     creating and initializing it with 'capacity' bytes if it doesn't
+        //     exist yet
+        // When opening an existing segment, 'capacity', 'chunkSize' and
+        //     'maxObjectSize' are taken from the segment and the arguments are
+        //     ignored
+        // Throws std::invalid_argument, before touching the segment, if
+        //     'maxObjectSize' is 0 or above 512 (64 size classes of 8 bytes)
+        //     or 'capacity' is 2^40 or more; std::runtime_error on failure
+        SharedSmallObjAllocator(
+            const char* name,
+            std::size_t capacity,
+            std::size_t chunkSize = DEFAULT_CHUNK_SIZE,
+            std::size_t maxObjectSize = MAX_SMALL_OBJECT_SIZE);
+        // Unmaps the segment; the segment itself survives until Unlink
+        ~SharedSmallObjAllocator();
+
+        // Removes the segment's name; processes that have it mapped keep
+        //     using it
+        static void Unlink(const char* name);
+
+        void* Allocate(std::size_t numBytes);
+        void Deallocate(void* p, std::size_t numBytes);
+
+        // Translate between addresses in this process and offsets that are
+        //     meaningful in every process that opened the segment
+        std::size_t ToOffset(const void* p) const
+        { return static_cast<const unsigned char*>(p) - pBase_; }
+
+        void* FromOffset(std::size_t offset) const
+        { return pBase_ + offset; }
+
+    private:
+        SharedSmallObjAllocator(const SharedSmallObjAllocator&);
+        SharedSmallObjAllocator& operator=(const SharedSmallObjAllocator&);
+
+        struct Header;
+
+        void Map(int fd, std::size_t size);
+        void Initialize(std::size_t capacity, std::size_t chunkSize,
+            std::size_t maxObjectSize);
+        void Push(std::size_t sizeClass, std::size_t first, std::size_t last);
+
+        unsigned char* pBase_;
+        std::size_t mappedSize_;
+        Header* pHeader_;
+    };
+} // namespace Loki
+
+#endif // SHAREDSMALLOBJ_INC_
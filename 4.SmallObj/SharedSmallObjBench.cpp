@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+// Two-process message throughput: zero-copy handoff through a
+//     SharedSmallObjAllocator segment versus copying the messages through a
+//     socketpair and a pipe
+// Build: g++ -O2 SharedSmallObjBench.cpp SharedSmallObj.cpp -lrt
+// Usage: ./a.out [messages]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SharedSmallObj.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace Loki;
+
+namespace
+{
+    const char segmentName[] = "/SharedSmallObjBench";
+
+    // One small message, as big as the largest small object
+    struct Message
+    {
+        uint64_t seq_;
+        uint64_t payload_[MAX_SMALL_OBJECT_SIZE / sizeof(uint64_t) - 1];
+    };
+
+    // Single-producer single-consumer ring of message offsets, placed in an
+    //     anonymous shared mapping inherited through fork()
+    const unsigned ringSize = 1024;
+
+    struct Ring
+    {
+        alignas(64) std::atomic<uint64_t> head_;
+        alignas(64) std::atomic<uint64_t> tail_;
+        alignas(64) uint64_t slots_[ringSize];
+    };
+
+    void Fill(Message& msg, uint64_t seq)
+    {
+        msg.seq_ = seq;
+        for (unsigned i = 0; i != sizeof(msg.payload_) / sizeof(uint64_t); ++i)
+        {
+            msg.payload_[i] = seq + i;
+        }
+    }
+
+    uint64_t Digest(const Message& msg)
+    {
+        uint64_t sum = msg.seq_;
+        for (unsigned i = 0; i != sizeof(msg.payload_) / sizeof(uint64_t); ++i)
+        {
+            sum += msg.payload_[i];
+        }
+        return sum;
+    }
+
+    bool ReadFully(int fd, void* p, std::size_t n)
+    {
+        char* pos = static_cast<char*>(p);
+        while (n)
+        {
+            ssize_t got = ::read(fd, pos, n);
+            if (got <= 0) return false;
+            pos += got;
+            n -= got;
+        }
+        return true;
+    }
+
+    bool WriteFully(int fd, const void* p, std::size_t n)
+    {
+        const char* pos = static_cast<const char*>(p);
+        while (n)
+        {
+            ssize_t put = ::write(fd, pos, n);
+            if (put <= 0) return false;
+            pos += put;
+            n -= put;
+        }
+        return true;
+    }
+
+    uint64_t Expected(uint64_t messages)
+    {
+        Message msg;
+        uint64_t sum = 0;
+        for (uint64_t seq = 0; seq != messages; ++seq)
+        {
+            Fill(msg, seq);
+            sum += Digest(msg);
+        }
+        return sum;
+    }
+
+    // Runs 'consumer' in a child process and 'producer' in this one; returns
+    //     the elapsed seconds, or a negative value if the consumer's digest
+    //     was wrong
+    template <class Producer, class Consumer>
+    double Run(Producer producer, Consumer consumer, uint64_t expected)
+    {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        pid_t pid = ::fork();
+        if (pid == 0)
+        {
+            ::_exit(consumer() == expected ? 0 : 1);
+        }
+        producer();
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        double elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1;
+    }
+
+    // Returns false if the run failed
+    bool Report(const char* name, double seconds, uint64_t messages)
+    {
+        if (seconds < 0)
+        {
+            std::printf("%-22s FAILED\n", name);
+            return false;
+        }
+        std::printf("%-22s %8.1f ns/msg %12.0f msg/s\n", name,
+            seconds * 1e9 / messages, messages / seconds);
+        return true;
+    }
+
+    struct SharedProducer
+    {
+        Ring* pRing_;
+        uint64_t messages_;
+
+        void operator()() const
+        {
+            SharedSmallObjAllocator pool(segmentName, 0);
+            for (uint64_t seq = 0; seq != messages_; ++seq)
+            {
+                Message* pMsg = new(pool.Allocate(sizeof(Message))) Message;
+                Fill(*pMsg, seq);
+                const uint64_t tail =
+                    pRing_->tail_.load(std::memory_order_relaxed);
+                while (tail - pRing_->head_.load(std::memory_order_acquire)
+                    == ringSize)
+                {
+                    ::sched_yield();
+                }
+                pRing_->slots_[tail % ringSize] = pool.ToOffset(pMsg);
+                pRing_->tail_.store(tail + 1, std::memory_order_release);
+            }
+        }
+    };
+
+    struct SharedConsumer
+    {
+        Ring* pRing_;
+        uint64_t messages_;
+
+        uint64_t operator()() const
+        {
+            // Opened again by name: the mapping address may differ
+            SharedSmallObjAllocator pool(segmentName, 0);
+            uint64_t sum = 0;
+            for (uint64_t head = 0; head != messages_; ++head)
+            {
+                while (pRing_->tail_.load(std::memory_order_acquire) == head)
+                {
+                    ::sched_yield();
+                }
+                Message* pMsg = static_cast<Message*>(
+                    pool.FromOffset(pRing_->slots_[head % ringSize]));
+                sum += Digest(*pMsg);
+                pool.Deallocate(pMsg, sizeof(Message));
+                pRing_->head_.store(head + 1, std::memory_order_release);
+            }
+            return sum;
+        }
+    };
+
+    struct CopyProducer
+    {
+        int fd_;
+        uint64_t messages_;
+
+        void operator()() const
+        {
+            Message msg;
+            for (uint64_t seq = 0; seq != messages_; ++seq)
+            {
+                Fill(msg, seq);
+                if (!WriteFully(fd_, &msg, sizeof(msg))) break;
+            }
+        }
+    };
+
+    struct CopyConsumer
+    {
+        int fd_;
+        uint64_t messages_;
+
+        uint64_t operator()() const
+        {
+            Message msg;
+            uint64_t sum = 0;
+            for (uint64_t seq = 0; seq != messages_; ++seq)
+            {
+                if (!ReadFully(fd_, &msg, sizeof(msg))) break;
+                sum += Digest(msg);
+            }
+            return sum;
+        }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    const uint64_t messages = argc > 1 ? std::strtoull(argv[1], 0, 10)
+        : 1000000;
+    const uint64_t expected = Expected(messages);
+    bool ok = true;
+
+    // Zero-copy handoff
+    SharedSmallObjAllocator::Unlink(segmentName);
+    {
+        SharedSmallObjAllocator pool(segmentName,
+            (ringSize + 1) * 4 * DEFAULT_CHUNK_SIZE);
+        void* p = ::mmap(0, sizeof(Ring), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return 1;
+        Ring* pRing = new(p) Ring;
+        pRing->head_.store(0);
+        pRing->tail_.store(0);
+
+        SharedProducer producer = { pRing, messages };
+        SharedConsumer consumer = { pRing, messages };
+        ok &= Report("shared memory handoff", Run(producer, consumer, expected),
+            messages);
+        ::munmap(p, sizeof(Ring));
+    }
+    SharedSmallObjAllocator::Unlink(segmentName);
+
+    // Copies through a socketpair
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return 1;
+    {
+        CopyProducer producer = { sv[0], messages };
+        CopyConsumer consumer = { sv[1], messages };
+        ok &= Report("socketpair copy", Run(producer, consumer, expected),
+            messages);
+    }
+    ::close(sv[0]);
+    ::close(sv[1]);
+
+    // Copies through a pipe
+    int fds[2];
+    if (::pipe(fds) != 0) return 1;
+    {
+        CopyProducer producer = { fds[1], messages };
+        CopyConsumer consumer = { fds[0], messages };
+        ok &= Report("pipe copy", Run(producer, consumer, expected),
+            messages);
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return ok ? 0 : 1;
+}
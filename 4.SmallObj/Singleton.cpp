@@ -16,29 +16,243 @@
 // Last update: June 20, 2001
 
 #include "Singleton.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace Loki::Private;
 
-Loki::Private::TrackerArray Loki::Private::pTrackerArray = 0;
-unsigned int Loki::Private::elements = 0;
+namespace // anoymous
+{
+    // A registered tracker; seq_ orders the trackers of a same longevity
+    struct Entry
+    {
+        unsigned int longevity_;
+        unsigned long seq_;
+        LifetimeTracker* pTracker_;
+        // Flush hooks run in every shutdown mode
+        bool flush_;
+    };
+
+    // Runs a flush hook in lieu of destroying an object
+    class FlushTracker : public LifetimeTracker
+    {
+    public:
+        FlushTracker(Loki::atexit_pfn_t hook, unsigned int longevity)
+            : LifetimeTracker(longevity), hook_(hook)
+        {}
+
+        ~FlushTracker()
+        { hook_(); }
+
+    private:
+        Loki::atexit_pfn_t hook_;
+    };
+
+    std::atomic<int> shutdownMode(Loki::DefaultShutdown);
+
+    // Heap order: the top is the next entry to destroy, i.e. the one with the
+    //     least longevity and, among those, the last registered
+    bool DestroyedLater(const Entry& lhs, const Entry& rhs)
+    {
+        if (lhs.longevity_ != rhs.longevity_)
+        {
+            return lhs.longevity_ > rhs.longevity_;
+        }
+        return lhs.seq_ < rhs.seq_;
+    }
+
+    struct Registry
+    {
+        std::mutex mutex_;
+        std::vector<Entry> heap_;
+        // Room set aside by ReserveTracker, not yet used by RegisterTracker
+        std::size_t reserved_;
+        unsigned long seq_;
+        bool hooked_;
+        unsigned int teardownThreads_;
+
+        Registry() : reserved_(0), seq_(0), hooked_(false), teardownThreads_(1)
+        {}
+    };
+
+    // Never destroyed, so that it outlives every object it tracks
+    Registry& TheRegistry()
+    {
+        static Registry* pRegistry = new Registry();
+        return *pRegistry;
+    }
+
+    void DestroyGroup(std::vector<LifetimeTracker*>& group, unsigned threads)
+    {
+        if (threads > group.size()) threads = unsigned(group.size());
+        if (threads <= 1)
+        {
+            for (std::size_t i = 0; i != group.size(); ++i) delete group[i];
+            return;
+        }
+        std::atomic<std::size_t> next(0);
+        const auto work = [&]()
+        {
+            std::size_t i;
+            while ((i = next.fetch_add(1)) < group.size()) delete group[i];
+        };
+        std::vector<std::thread> pool;
+        try
+        {
+            for (unsigned t = 1; t < threads; ++t) pool.push_back(
+                std::thread(work));
+        }
+        catch (...)
+        {
+            // Can't start threads at this point: the others do the work
+        }
+        work();
+        for (std::size_t t = 0; t != pool.size(); ++t) pool[t].join();
+    }
+
+    void C_CALLING_CONVENTION_QUALIFIER AtExitFn();
+
+    void Register(LifetimeTracker* p, bool flush)
+    {
+        Registry& registry = TheRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex_);
+        assert(registry.reserved_ > 0);
+        --registry.reserved_;
+        Entry entry = { p->Longevity(), registry.seq_++, p, flush };
+        registry.heap_.push_back(entry);
+        std::push_heap(registry.heap_.begin(), registry.heap_.end(),
+            DestroyedLater);
+        if (!registry.hooked_)
+        {
+            registry.hooked_ = true;
+            std::atexit(AtExitFn);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function ReserveTracker
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::Private::ReserveTracker()
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    std::vector<Entry>& heap = registry.heap_;
+    const std::size_t needed = heap.size() + registry.reserved_ + 1;
+    // Grows geometrically, for amortized constant time
+    if (needed > heap.capacity())
+    {
+        heap.reserve(std::max(needed, 2 * heap.capacity()));
+    }
+    ++registry.reserved_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function RegisterTracker
+// O(log n); hooks AtExitFn upon the first registration
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::Private::RegisterTracker(LifetimeTracker* p)
+{
+    Register(p, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function RegisterFlushHook
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::RegisterFlushHook(atexit_pfn_t hook, unsigned int longevity)
+{
+    ReserveTracker();
+    Register(new FlushTracker(hook, longevity), true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// functions SetShutdownMode and GetShutdownMode
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::SetShutdownMode(ShutdownMode mode)
+{
+    shutdownMode.store(mode);
+}
+
+Loki::ShutdownMode Loki::GetShutdownMode()
+{
+    return static_cast<ShutdownMode>(shutdownMode.load());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function SetTeardownThreads
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::SetTeardownThreads(unsigned int threads)
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    registry.teardownThreads_ = threads;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // function AtExitFn
 // Ensures proper destruction of objects with longevity
+// Destroys them a longevity group at a time; objects registered meanwhile (by
+//     the destructors) get destroyed too
+// With FastExit, runs the flush hooks only
 ////////////////////////////////////////////////////////////////////////////////
 
-void C_CALLING_CONVENTION_QUALIFIER Loki::Private::AtExitFn()
+namespace // anoymous
 {
-    assert(elements > 0 && pTrackerArray != 0);
-    // Pick the element at the top of the stack
-    LifetimeTracker* pTop = pTrackerArray[elements - 1];
-    // Remove that object off the stack
-    // Don't check errors - realloc with less memory 
-    //     can't fail
-    pTrackerArray = static_cast<TrackerArray>(std::realloc(
-        pTrackerArray, sizeof(*pTrackerArray) * --elements));
-    // Destroy the element
-    delete pTop;
+    void C_CALLING_CONVENTION_QUALIFIER AtExitFn()
+    {
+        Registry& registry = TheRegistry();
+        std::vector<LifetimeTracker*> group;
+        for (;;)
+        {
+            unsigned int threads;
+            {
+                std::lock_guard<std::mutex> lock(registry.mutex_);
+                std::vector<Entry>& heap = registry.heap_;
+                if (heap.empty())
+                {
+                    // Later registrations need another hook
+                    registry.hooked_ = false;
+                    return;
+                }
+                const unsigned int longevity = heap.front().longevity_;
+                const bool destroy = shutdownMode.load() != Loki::FastExit;
+                group.clear();
+                while (!heap.empty() && heap.front().longevity_ == longevity)
+                {
+                    if (destroy || heap.front().flush_)
+                    {
+                        group.push_back(heap.front().pTracker_);
+                    }
+                    std::pop_heap(heap.begin(), heap.end(), DestroyedLater);
+                    heap.pop_back();
+                }
+                threads = registry.teardownThreads_;
+            }
+            DestroyGroup(group, threads);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function Exit
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::Exit(int status)
+{
+    if (GetShutdownMode() != FastExit) std::exit(status);
+
+    AtExitFn();
+    std::fflush(0);
+    std::_Exit(status);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -47,4 +261,7 @@ void C_CALLING_CONVENTION_QUALIFIER Loki::Private::AtExitFn()
 // January 10, 2002: Fixed bug in call to realloc - credit due to Nigel Gent and
 //      Eike Petersen
 // May 08, 2002: Refixed bug in call to realloc
+// Replaced the realloc'ed tracker array with a heap-based registry destroyed by
+//      a single exit hook
+// Added the shutdown modes, the flush hooks and Exit
 ////////////////////////////////////////////////////////////////////////////////
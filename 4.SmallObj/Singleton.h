@@ -18,10 +18,12 @@
 
 #include "Threads.h"
 #include <algorithm>
+#include <atomic>
 #include <stdexcept>
 #include <cassert>
 #include <cstdlib>
 #include <new>
+#include <type_traits>
 
 #ifdef _MSC_VER
 #define C_CALLING_CONVENTION_QUALIFIER __cdecl 
@@ -29,6 +31,37 @@
 #define C_CALLING_CONVENTION_QUALIFIER 
 #endif
 
+// Makes a non-constant initialization of a CreateConstant object a compile
+//     error: constinit in C++20, or its equivalent as a GCC or Clang extension
+//     before. Elsewhere CreateConstant checks what a constant expression can
+//     (see below)
+#if defined(__cpp_constinit) && __cpp_constinit >= 201907L
+#define SINGLETON_CONSTINIT constinit
+#elif defined(__clang__)
+#define SINGLETON_CONSTINIT [[clang::require_constant_initialization]]
+#elif defined(__GNUC__) && __GNUC__ >= 10
+#define SINGLETON_CONSTINIT __constinit
+#else
+#define SINGLETON_CONSTINIT
+#define SINGLETON_CONSTINIT_UNCHECKED
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// macro PROFILE_SINGLETONS
+// Defining PROFILE_SINGLETONS makes SingletonHolder record when it constructs
+//     and destroys its objects, and how long that takes (see
+//     SingletonProfiler.h)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef PROFILE_SINGLETONS
+#include "SingletonProfiler.h"
+#include <typeinfo>
+#define SINGLETON_PROFILE_SCOPE(T, phase) ::Loki::SingletonProfiler::Scope \
+    singletonProfileScope_(typeid(T), ::Loki::SingletonProfiler::phase)
+#else
+#define SINGLETON_PROFILE_SCOPE(T, phase) /**/
+#endif
+
 namespace Loki
 {
     typedef void (C_CALLING_CONVENTION_QUALIFIER *atexit_pfn_t)();
@@ -48,11 +81,8 @@ namespace Loki
             
             virtual ~LifetimeTracker() = 0;
             
-            static bool Compare(const LifetimeTracker* lhs,
-                const LifetimeTracker* rhs)
-            {
-                return lhs->longevity_ < rhs->longevity_;
-            }
+            unsigned int Longevity() const
+            { return longevity_; }
             
         private:
             unsigned int longevity_;
@@ -61,10 +91,11 @@ namespace Loki
         // Definition required
         inline LifetimeTracker::~LifetimeTracker() {} 
         
-        // Helper data
-        typedef LifetimeTracker** TrackerArray;
-        extern TrackerArray pTrackerArray;
-        extern unsigned int elements;
+        // Registry of the trackers, destroyed by a single exit hook
+        // ReserveTracker makes room for one more tracker (and may throw
+        //     std::bad_alloc); RegisterTracker then adds it without failing
+        void ReserveTracker();
+        void RegisterTracker(LifetimeTracker* p);
 
         // Helper destroyer function
         template <typename T>
@@ -92,14 +123,17 @@ namespace Loki
             T* pTracked_;
             Destroyer destroyer_;
         };
-
-        void C_CALLING_CONVENTION_QUALIFIER AtExitFn(); // declaration needed below    
     } // namespace Private
 
 ////////////////////////////////////////////////////////////////////////////////
 // function template SetLongevity
 // Assigns an object a longevity; ensures ordered destructions of objects 
 //     registered thusly during the exit sequence of the application
+// Objects with lesser longevity are destroyed first; objects with the same
+//     longevity are destroyed in reverse order of registration (or in
+//     parallel, see SetTeardownThreads)
+// Registration costs O(log n); all the objects are destroyed by a single
+//     function registered with std::atexit upon the first registration
 ////////////////////////////////////////////////////////////////////////////////
 
     template <typename T, typename Destroyer>
@@ -108,34 +142,54 @@ namespace Loki
     {
         using namespace Private;
         
-        TrackerArray pNewArray = static_cast<TrackerArray>(
-                std::realloc(pTrackerArray, 
-                    sizeof(*pTrackerArray) * (elements + 1)));
-        if (!pNewArray) throw std::bad_alloc();
-        
-        // Delayed assignment for exception safety
-        pTrackerArray = pNewArray;
+        // Done first for exception safety
+        ReserveTracker();
         
         LifetimeTracker* p = new ConcreteLifetimeTracker<T, Destroyer>(
             pDynObject, longevity, d);
-        
-        // Insert a pointer to the object into the queue
-        TrackerArray pos = std::upper_bound(
-            pTrackerArray, 
-            pTrackerArray + elements, 
-            p, 
-            LifetimeTracker::Compare);
-        std::copy_backward(
-            pos, 
-            pTrackerArray + elements,
-            pTrackerArray + elements + 1);
-        *pos = p;
-        ++elements;
-        
-        // Register a call to AtExitFn
-        std::atexit(Private::AtExitFn);
+        RegisterTracker(p);
     }
 
+////////////////////////////////////////////////////////////////////////////////
+// function SetTeardownThreads
+// Sets how many threads destroy the objects that share a longevity at exit
+// The default, 1, destroys them one at a time, in reverse order of
+//     registration; with more threads their destructors must not depend on
+//     one another
+////////////////////////////////////////////////////////////////////////////////
+
+    void SetTeardownThreads(unsigned int threads);
+
+////////////////////////////////////////////////////////////////////////////////
+// Shutdown modes
+// DefaultShutdown: objects are destroyed at exit as per their LifetimePolicy
+// FastExit: nothing Loki manages is destroyed (the memory goes back to the
+//     system with the process anyway); only the flush hooks run, in longevity
+//     order. Exit() then ends the process without running the rest of the
+//     exit sequence
+// FullTeardown: everything is destroyed, including the NoDestroy singletons
+//     created once the mode is set, so that leak checkers see a clean heap
+////////////////////////////////////////////////////////////////////////////////
+
+    enum ShutdownMode
+    {
+        DefaultShutdown,
+        FastExit,
+        FullTeardown
+    };
+
+    void SetShutdownMode(ShutdownMode mode);
+    ShutdownMode GetShutdownMode();
+
+    // Registers a function that saves state that must survive the process
+    //     (flushes a log, syncs a file...); it runs at exit in every mode,
+    //     ordered with the objects with longevity as if it were one of them
+    void RegisterFlushHook(atexit_pfn_t hook, unsigned int longevity);
+
+    // Ends the process: in FastExit mode, runs the flush hooks, flushes the
+    //     C streams and calls std::_Exit; otherwise calls std::exit
+    void Exit(int status);
+
 ////////////////////////////////////////////////////////////////////////////////
 // class template CreateUsingNew
 // Implementation of the CreationPolicy used by SingletonHolder
@@ -312,14 +366,16 @@ namespace Loki
 ////////////////////////////////////////////////////////////////////////////////
 // class template NoDestroy
 // Implementation of the LifetimePolicy used by SingletonHolder
-// Never destroys the object
+// Never destroys the object, unless the shutdown mode is FullTeardown
 ////////////////////////////////////////////////////////////////////////////////
 
     template <class T>
     struct NoDestroy
     {
         static void ScheduleDestruction(T*, atexit_pfn_t pFun)
-        {}
+        {
+            if (GetShutdownMode() == FullTeardown) std::atexit(pFun);
+        }
         
         static void OnDeadReference()
         {}
@@ -330,6 +386,8 @@ namespace Loki
 // Provides Singleton amenities for a type T
 // To protect that type from spurious instantiations, you have to protect it
 //     yourself.
+// Once the object exists, Instance() is a single acquire load; creation is
+//     serialized by ThreadingModel's Lock and published with a release store
 ////////////////////////////////////////////////////////////////////////////////
 
     template
@@ -353,7 +411,7 @@ namespace Loki
         SingletonHolder();
         
         // Data
-        typedef typename ThreadingModel<T*>::VolatileType PtrInstanceType;
+        typedef std::atomic<T*> PtrInstanceType;
         static PtrInstanceType pInstance_;
         static bool destroyed_;
     };
@@ -395,11 +453,13 @@ namespace Loki
     inline T& SingletonHolder<T, CreationPolicy, 
         LifetimePolicy, ThreadingModel>::Instance()
     {
-        if (!pInstance_)
+        T* pInstance = pInstance_.load(std::memory_order_acquire);
+        if (!pInstance)
         {
             MakeInstance();
+            pInstance = pInstance_.load(std::memory_order_relaxed);
         }
-        return *pInstance_;
+        return *pInstance;
     }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -419,15 +479,18 @@ namespace Loki
         typename ThreadingModel<T>::Lock guard;
         (void)guard;
         
-        if (!pInstance_)
+        if (!pInstance_.load(std::memory_order_relaxed))
         {
             if (destroyed_)
             {
                 LifetimePolicy<T>::OnDeadReference();
                 destroyed_ = false;
             }
-            pInstance_ = CreationPolicy<T>::Create();
-            LifetimePolicy<T>::ScheduleDestruction(pInstance_, 
+            SINGLETON_PROFILE_SCOPE(T, Construction);
+            T* pInstance = CreationPolicy<T>::Create();
+            // Publishes the fully constructed object to Instance()
+            pInstance_.store(pInstance, std::memory_order_release);
+            LifetimePolicy<T>::ScheduleDestruction(pInstance, 
                 &DestroySingleton);
         }
     }
@@ -443,10 +506,373 @@ namespace Loki
     SingletonHolder<T, CreationPolicy, L, M>::DestroySingleton()
     {
         assert(!destroyed_);
-        CreationPolicy<T>::Destroy(pInstance_);
-        pInstance_ = 0;
+        // The object stays usable until the very end
+        if (GetShutdownMode() == FastExit) return;
+        SINGLETON_PROFILE_SCOPE(T, Destruction);
+        CreationPolicy<T>::Destroy(
+            pInstance_.load(std::memory_order_relaxed));
+        pInstance_.store(0, std::memory_order_relaxed);
         destroyed_ = true;
     }
+
+////////////////////////////////////////////////////////////////////////////////
+// class template ThreadLocalLifetime
+// Implementation of the LifetimePolicy used by SingletonHolder
+// Gives each thread an instance of its own, created on the thread's first call
+//     to Instance() and destroyed when the thread exits; no locking is
+//     involved, whatever the ThreadingModel
+// Meant for objects that are singletons only for ease of access (scratch
+//     buffers, random number generators...)
+// Doesn't work with CreateStatic or CreateConstant, whose storage is shared by
+//     all threads
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class T>
+    struct ThreadLocalLifetime
+    {};
+
+    template
+    <
+        class T,
+        template <class> class CreationPolicy,
+        template <class> class ThreadingModel
+    >
+    class SingletonHolder<T, CreationPolicy, ThreadLocalLifetime,
+        ThreadingModel>
+    {
+        static_assert(!std::is_same<CreationPolicy<T>, CreateStatic<T> >::value,
+            "ThreadLocalLifetime needs per-thread storage");
+
+    public:
+        static T& Instance()
+        {
+            T* pInstance = pInstance_;
+            if (!pInstance) pInstance = MakeInstance();
+            return *pInstance;
+        }
+
+    private:
+        // Destroys the calling thread's instance when the thread exits
+        struct Destroyer
+        {
+            ~Destroyer()
+            {
+                if (!pInstance_) return;
+                SINGLETON_PROFILE_SCOPE(T, Destruction);
+                CreationPolicy<T>::Destroy(pInstance_);
+                pInstance_ = 0;
+            }
+        };
+
+        static T* MakeInstance()
+        {
+            static thread_local Destroyer destroyer;
+            (void)destroyer;
+            SINGLETON_PROFILE_SCOPE(T, Construction);
+            pInstance_ = CreationPolicy<T>::Create();
+            return pInstance_;
+        }
+
+        // Protection
+        SingletonHolder();
+
+        // Data
+        static thread_local T* pInstance_;
+    };
+
+    template
+    <
+        class T,
+        template <class> class C,
+        template <class> class M
+    >
+    thread_local T* SingletonHolder<T, C, ThreadLocalLifetime, M>::pInstance_;
+
+////////////////////////////////////////////////////////////////////////////////
+// class template CreateConstant
+// Implementation of the CreationPolicy used by SingletonHolder
+// For types whose default constructor is constexpr: the object is constant
+//     initialized in static storage, i.e. it exists before any code runs, so
+//     Instance() is a plain address, with no test and no lock whatever the
+//     ThreadingModel
+// The object's destruction is scheduled during dynamic initialization, as per
+//     the LifetimePolicy (trivially destructible objects are never destroyed)
+// The Scheduler runs during dynamic initialization, before main, so with
+//     NoDestroy a later SetShutdownMode(FullTeardown) comes too late to get
+//     the object destroyed
+// A use after destruction isn't detected, since detecting it would cost the
+//     test: such objects should be trivially destructible, or live with
+//     NoDestroy, or with a longevity greater than their users'
+// Where SINGLETON_CONSTINIT can't check the initialization, T must be a
+//     literal type (so trivially destructible before C++20), for the check to
+//     be done in a constant expression instead
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class T>
+    struct CreateConstant
+    {};
+
+    namespace Private
+    {
+        // Tells whether T() is a constant expression
+        template <class T, int = (static_cast<void>(T()), 0)>
+        std::true_type IsConstantDefault(int);
+
+        template <class T>
+        std::false_type IsConstantDefault(long);
+    }
+
+    template
+    <
+        class T,
+        template <class> class LifetimePolicy,
+        template <class> class ThreadingModel
+    >
+    class SingletonHolder<T, CreateConstant, LifetimePolicy, ThreadingModel>
+    {
+#ifdef SINGLETON_CONSTINIT_UNCHECKED
+        static_assert(decltype(Private::IsConstantDefault<T>(0))::value,
+            "CreateConstant needs a constexpr default constructor and, where "
+            "constinit isn't available, a trivial destructor");
+#endif
+
+        // Lets the object be constructed without being destroyed at exit
+        union Storage
+        {
+            constexpr Storage() : object_()
+            {}
+
+            ~Storage()
+            {}
+
+            T object_;
+        };
+
+        // Does the run time part of the LifetimePolicy, at startup
+        struct Scheduler
+        {
+            Scheduler()
+            {
+                if (std::is_trivially_destructible<T>::value) return;
+                LifetimePolicy<T>::ScheduleDestruction(&storage_.object_,
+                    &DestroySingleton);
+            }
+        };
+
+    public:
+        static T& Instance()
+        {
+            // Instantiates scheduler_; costs nothing at run time
+            (void)&scheduler_;
+            return storage_.object_;
+        }
+
+    private:
+        static void C_CALLING_CONVENTION_QUALIFIER DestroySingleton()
+        {
+            if (GetShutdownMode() == FastExit) return;
+            SINGLETON_PROFILE_SCOPE(T, Destruction);
+            storage_.object_.~T();
+        }
+
+        // Protection
+        SingletonHolder();
+
+        // Data
+        static Storage storage_;
+        static Scheduler scheduler_;
+    };
+
+    template
+    <
+        class T,
+        template <class> class L,
+        template <class> class M
+    >
+    SINGLETON_CONSTINIT
+    typename SingletonHolder<T, CreateConstant, L, M>::Storage
+        SingletonHolder<T, CreateConstant, L, M>::storage_;
+
+    template
+    <
+        class T,
+        template <class> class L,
+        template <class> class M
+    >
+    typename SingletonHolder<T, CreateConstant, L, M>::Scheduler
+        SingletonHolder<T, CreateConstant, L, M>::scheduler_;
+
+    // A single constant object can't be given to each thread
+    template
+    <
+        class T,
+        template <class> class ThreadingModel
+    >
+    class SingletonHolder<T, CreateConstant, ThreadLocalLifetime,
+        ThreadingModel>
+    {
+        static_assert(sizeof(T) == 0,
+            "CreateConstant can't be combined with ThreadLocalLifetime");
+    };
+
+#ifndef _WINDOWS_
+
+////////////////////////////////////////////////////////////////////////////////
+// class template PerCpuLifetime
+// Implementation of the LifetimePolicy used by SingletonHolder
+// Shards the singleton: Instance() returns the instance of the processor the
+//     caller runs on (one of PER_CPU_SINGLETON_SLOTS, each created on first
+//     use); ForEach and Aggregate visit all the instances created so far
+// A thread may be migrated while it uses an instance, and several threads
+//     may share one, so the instances must still be thread-safe (typically
+//     through atomic counters): sharding only removes the contention
+// All the instances are destroyed at exit together, with longevity
+//     PER_CPU_SINGLETON_LONGEVITY (see SetLongevity); FastExit skips that
+// Doesn't work with CreateStatic or CreateConstant, whose storage can hold a
+//     single instance
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PER_CPU_SINGLETON_SLOTS
+#define PER_CPU_SINGLETON_SLOTS 64
+#endif
+
+#ifndef PER_CPU_SINGLETON_LONGEVITY
+#define PER_CPU_SINGLETON_LONGEVITY 0
+#endif
+
+    template <class T>
+    struct PerCpuLifetime
+    {};
+
+    template
+    <
+        class T,
+        template <class> class CreationPolicy,
+        template <class> class ThreadingModel
+    >
+    class SingletonHolder<T, CreationPolicy, PerCpuLifetime, ThreadingModel>
+    {
+        static_assert(!std::is_same<CreationPolicy<T>, CreateStatic<T> >::value,
+            "PerCpuLifetime needs an instance per processor");
+
+        struct alignas(64) Slot
+        {
+            std::atomic<T*> pInstance_;
+        };
+
+    public:
+        static T& Instance()
+        {
+            Slot& slot = slots_[Private::CurrentSlot(PER_CPU_SINGLETON_SLOTS)];
+            T* pInstance = slot.pInstance_.load(std::memory_order_acquire);
+            if (!pInstance) pInstance = MakeInstance(slot);
+            return *pInstance;
+        }
+
+        // Calls fun(T&) on every instance created so far
+        template <class Fun>
+        static void ForEach(Fun fun)
+        {
+            for (unsigned i = 0; i != PER_CPU_SINGLETON_SLOTS; ++i)
+            {
+                T* pInstance =
+                    slots_[i].pInstance_.load(std::memory_order_acquire);
+                if (pInstance) fun(*pInstance);
+            }
+        }
+
+        // Folds the instances created so far: returns
+        //     fun(...fun(fun(init, t1), t2)..., tn)
+        template <class R, class Fun>
+        static R Aggregate(R init, Fun fun)
+        {
+            for (unsigned i = 0; i != PER_CPU_SINGLETON_SLOTS; ++i)
+            {
+                T* pInstance =
+                    slots_[i].pInstance_.load(std::memory_order_acquire);
+                if (pInstance) init = fun(init, *pInstance);
+            }
+            return init;
+        }
+
+    private:
+        static T* MakeInstance(Slot& slot)
+        {
+            typename ThreadingModel<T>::Lock guard;
+            (void)guard;
+
+            T* pInstance = slot.pInstance_.load(std::memory_order_relaxed);
+            if (!pInstance)
+            {
+                SINGLETON_PROFILE_SCOPE(T, Construction);
+                pInstance = CreationPolicy<T>::Create();
+                slot.pInstance_.store(pInstance, std::memory_order_release);
+                if (!scheduled_)
+                {
+                    Private::Adapter<T> adapter = { &DestroySingletons };
+                    SetLongevity(pInstance, PER_CPU_SINGLETON_LONGEVITY,
+                        adapter);
+                    scheduled_ = true;
+                }
+            }
+            return pInstance;
+        }
+
+        static void C_CALLING_CONVENTION_QUALIFIER DestroySingletons()
+        {
+            if (GetShutdownMode() == FastExit) return;
+            for (unsigned i = 0; i != PER_CPU_SINGLETON_SLOTS; ++i)
+            {
+                T* pInstance = slots_[i].pInstance_.exchange(0);
+                if (pInstance)
+                {
+                    SINGLETON_PROFILE_SCOPE(T, Destruction);
+                    CreationPolicy<T>::Destroy(pInstance);
+                }
+            }
+            // Instances recreated from now on get destroyed too
+            scheduled_ = false;
+        }
+
+        // Protection
+        SingletonHolder();
+
+        // Data
+        static Slot slots_[PER_CPU_SINGLETON_SLOTS];
+        static bool scheduled_;
+    };
+
+    template
+    <
+        class T,
+        template <class> class C,
+        template <class> class M
+    >
+    typename SingletonHolder<T, C, PerCpuLifetime, M>::Slot
+        SingletonHolder<T, C, PerCpuLifetime, M>::slots_[
+            PER_CPU_SINGLETON_SLOTS];
+
+    template
+    <
+        class T,
+        template <class> class C,
+        template <class> class M
+    >
+    bool SingletonHolder<T, C, PerCpuLifetime, M>::scheduled_;
+
+    // A single constant object can't be sharded
+    template
+    <
+        class T,
+        template <class> class ThreadingModel
+    >
+    class SingletonHolder<T, CreateConstant, PerCpuLifetime, ThreadingModel>
+    {
+        static_assert(sizeof(T) == 0,
+            "CreateConstant can't be combined with PerCpuLifetime");
+    };
+
+#endif // _WINDOWS_
 } // namespace Loki
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -459,6 +885,11 @@ namespace Loki
 //      exception safety issue. Credit due to Kari Hoijarvi
 // May 09, 2002: Fixed bug in Compare that caused longevities to act backwards.
 //      Credit due to Scott McDonald.
+// Replaced the realloc'ed tracker array and the atexit call per object with a
+//      heap-based registry and a single exit hook
+// Added the FastExit and FullTeardown shutdown modes and the flush hooks
+// Added PROFILE_SINGLETONS
+// Added CreateConstant
 ////////////////////////////////////////////////////////////////////////////////
 
 #endif // SINGLETON_INC_
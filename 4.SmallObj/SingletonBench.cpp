@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// Cost of SingletonHolder::Instance() once the object exists, from 1 to N
+//     threads calling it concurrently, against a function-local static and
+//     against taking the ThreadingModel's Lock on every call
+// The thread-local and per-processor lifetimes and CreateConstant are measured
+//     too
+// Build: g++ -O2 -pthread SingletonBench.cpp Singleton.cpp
+// Usage: ./a.out [calls per thread]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Singleton.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace Loki;
+
+namespace
+{
+    struct Config
+    {
+        long value_;
+
+        constexpr Config() : value_(1)
+        {}
+    };
+
+    typedef SingletonHolder<Config, CreateStatic, DefaultLifetime,
+        SingleThreaded> SingleThreadedConfig;
+    typedef SingletonHolder<Config, CreateStatic, DefaultLifetime,
+        ClassLevelLockable> ThreadSafeConfig;
+    typedef SingletonHolder<Config, CreateUsingNew, ThreadLocalLifetime>
+        ThreadLocalConfig;
+    typedef SingletonHolder<Config, CreateUsingNew, PerCpuLifetime,
+        ClassLevelLockable> PerCpuConfig;
+    typedef SingletonHolder<Config, CreateConstant, DefaultLifetime,
+        ClassLevelLockable> ConstantConfig;
+
+    Config& LocalStatic()
+    {
+        static Config config;
+        return config;
+    }
+
+    // What Instance() would cost if it locked every time
+    Config& AlwaysLocked()
+    {
+        ClassLevelLockable<Config>::Lock lock;
+        (void)lock;
+        return LocalStatic();
+    }
+
+    template <Config& (*instance)()>
+    double Run(unsigned threads, unsigned long calls)
+    {
+        instance();
+        std::atomic<unsigned> ready(0);
+        std::atomic<bool> go(false);
+        std::atomic<long> sum(0);
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t != threads; ++t)
+        {
+            pool.push_back(std::thread([&]()
+            {
+                ++ready;
+                while (!go.load()) {}
+                long local = 0;
+                for (unsigned long i = 0; i != calls; ++i)
+                {
+                    local += instance().value_;
+                    // Keeps the call from being hoisted out of the loop
+                    std::atomic_signal_fence(std::memory_order_seq_cst);
+                }
+                sum += local;
+            }));
+        }
+        while (ready.load() != threads) {}
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        go.store(true);
+        for (unsigned t = 0; t != threads; ++t) pool[t].join();
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() /
+            (double(threads) * calls);
+    }
+
+    template <Config& (*instance)()>
+    void Row(const char* name, unsigned threads, unsigned long calls)
+    {
+        std::printf("%-36s", name);
+        for (unsigned n = 1; n <= threads; n *= 2)
+        {
+            std::printf(" %8.2f", Run<instance>(n, calls));
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned long calls = argc > 1
+        ? std::strtoul(argv[1], 0, 10) : 100000000;
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 2;
+
+    std::printf("ns/call, 1 to %u threads\n%-36s", threads, "");
+    for (unsigned n = 1; n <= threads; n *= 2) std::printf(" %8u", n);
+    std::printf("\n");
+    Row<SingleThreadedConfig::Instance>("Instance(), SingleThreaded", threads,
+        calls);
+    Row<ThreadSafeConfig::Instance>("Instance(), ClassLevelLockable", threads,
+        calls);
+    Row<ThreadLocalConfig::Instance>("Instance(), ThreadLocalLifetime",
+        threads, calls);
+    Row<PerCpuConfig::Instance>("Instance(), PerCpuLifetime", threads, calls);
+    Row<ConstantConfig::Instance>("Instance(), CreateConstant", threads,
+        calls);
+    Row<LocalStatic>("function-local static", threads, calls);
+    Row<AlwaysLocked>("Lock on every call", threads, calls / 10);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "SingletonProfiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <cxxabi.h>
+
+using namespace Loki;
+
+namespace // anoymous
+{
+    const std::size_t none = std::size_t(-1);
+
+    // Leaked, so that the destructions run at exit get recorded too
+    struct Log
+    {
+        std::mutex mutex_;
+        std::vector<SingletonProfiler::Event> events_;
+    };
+
+    Log& TheLog()
+    {
+        static Log* pLog = new Log;
+        return *pLog;
+    }
+
+    // Innermost event in progress on this thread
+    thread_local std::size_t openEvent = none;
+    thread_local unsigned threadNumber = 0;
+    std::atomic<unsigned> threadCount(0);
+
+    long long Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    unsigned ThreadNumber()
+    {
+        if (!threadNumber) threadNumber = ++threadCount;
+        return threadNumber;
+    }
+
+    std::string Demangle(const char* name)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name, 0, 0, &status);
+        if (!demangled) return name;
+        std::string result(demangled);
+        std::free(demangled);
+        return result;
+    }
+
+    // Escapes a string for a JSON string literal
+    std::string Json(const std::string& s)
+    {
+        std::string result;
+        for (std::size_t i = 0; i != s.size(); ++i)
+        {
+            if (s[i] == '"' || s[i] == '\\') result += '\\';
+            result += s[i];
+        }
+        return result;
+    }
+
+    // Folded stacks use ';' as separator and ' ' before the count
+    std::string Frame(const std::string& s)
+    {
+        std::string result(s);
+        for (std::size_t i = 0; i != result.size(); ++i)
+        {
+            if (result[i] == ';' || result[i] == ' ') result[i] = '_';
+        }
+        return result;
+    }
+
+    const char* PhaseName(SingletonProfiler::Phase phase)
+    {
+        return phase == SingletonProfiler::Construction
+            ? "construction" : "destruction";
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SingletonProfiler::Begin and SingletonProfiler::End
+////////////////////////////////////////////////////////////////////////////////
+
+std::size_t SingletonProfiler::Begin(const std::type_info& object, Phase phase)
+{
+    Log& log = TheLog();
+    const unsigned thread = ThreadNumber();
+    std::lock_guard<std::mutex> lock(log.mutex_);
+    const std::size_t parent =
+        openEvent < log.events_.size() ? openEvent : none;
+    Event event = { &object, phase, Now(), -1, thread, parent,
+        parent == none ? 0 : log.events_[parent].depth_ + 1 };
+    openEvent = log.events_.size();
+    log.events_.push_back(event);
+    return openEvent;
+}
+
+void SingletonProfiler::End(std::size_t index)
+{
+    const long long end = Now();
+    Log& log = TheLog();
+    std::lock_guard<std::mutex> lock(log.mutex_);
+    // Gone if Reset was called meanwhile
+    if (index >= log.events_.size()) return;
+    Event& event = log.events_[index];
+    event.durationNs_ = end - event.startNs_;
+    openEvent = event.parent_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SingletonProfiler::Events
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<SingletonProfiler::Event> SingletonProfiler::Events()
+{
+    Log& log = TheLog();
+    std::lock_guard<std::mutex> lock(log.mutex_);
+    return log.events_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SingletonProfiler::WriteChromeTrace
+////////////////////////////////////////////////////////////////////////////////
+
+void SingletonProfiler::WriteChromeTrace(std::ostream& os)
+{
+    const std::vector<Event> events = Events();
+    const long long origin = events.empty() ? 0 : events.front().startNs_;
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    // Microseconds, to the nanosecond
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for (std::size_t i = 0; i != events.size(); ++i)
+    {
+        const Event& event = events[i];
+        if (event.durationNs_ < 0) continue;
+        os << separator
+           << "{\"name\":\"" << Json(Demangle(event.object_->name()))
+           << "\",\"cat\":\"" << PhaseName(event.phase_)
+           << "\",\"ph\":\"X\",\"ts\":" << (event.startNs_ - origin) / 1e3
+           << ",\"dur\":" << event.durationNs_ / 1e3
+           << ",\"pid\":1,\"tid\":" << event.thread_
+           << ",\"args\":{\"depth\":" << event.depth_;
+        if (event.parent_ != none)
+        {
+            os << ",\"parent\":\""
+               << Json(Demangle(events[event.parent_].object_->name())) << '"';
+        }
+        os << "}}";
+        separator = ",\n";
+    }
+    os << "\n]}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SingletonProfiler::WriteFoldedStacks
+////////////////////////////////////////////////////////////////////////////////
+
+void SingletonProfiler::WriteFoldedStacks(std::ostream& os)
+{
+    const std::vector<Event> events = Events();
+
+    // Self time: the duration minus that of the nested events
+    std::vector<long long> selfNs(events.size());
+    for (std::size_t i = 0; i != events.size(); ++i)
+    {
+        selfNs[i] += events[i].durationNs_;
+        if (events[i].parent_ != none)
+        {
+            selfNs[events[i].parent_] -= events[i].durationNs_;
+        }
+    }
+
+    std::map<std::string, long long> stacks;
+    for (std::size_t i = 0; i != events.size(); ++i)
+    {
+        if (events[i].durationNs_ < 0) continue;
+        std::string stack;
+        for (std::size_t j = i; j != none; j = events[j].parent_)
+        {
+            stack = ';' + Frame(Demangle(events[j].object_->name())) + stack;
+        }
+        // The outermost event tells whether this is startup or shutdown
+        std::size_t root = i;
+        while (events[root].parent_ != none) root = events[root].parent_;
+        stacks[PhaseName(events[root].phase_) + stack] +=
+            selfNs[i] > 0 ? selfNs[i] : 0;
+    }
+
+    for (std::map<std::string, long long>::const_iterator i = stacks.begin();
+        i != stacks.end(); ++i)
+    {
+        os << i->first << ' ' << i->second << '\n';
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SingletonProfiler::Reset
+////////////////////////////////////////////////////////////////////////////////
+
+void SingletonProfiler::Reset()
+{
+    Log& log = TheLog();
+    std::lock_guard<std::mutex> lock(log.mutex_);
+    log.events_.clear();
+}
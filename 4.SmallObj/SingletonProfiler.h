@@ -0,0 +1,89 @@
+#ifndef SINGLETONPROFILER_INC_
+#define SINGLETONPROFILER_INC_
+
+#include <cstddef>
+#include <iosfwd>
+#include <typeinfo>
+#include <vector>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class SingletonProfiler
+// Timeline of the constructions and destructions done by SingletonHolder,
+//     recorded when Singleton.h is compiled with PROFILE_SINGLETONS defined
+//     (link with SingletonProfiler.cpp then)
+// Each event records the object's type, when it started and how long it took,
+//     the thread, and the event it is nested in: the construction of a
+//     singleton that calls another singleton's Instance() is the parent of
+//     that singleton's construction
+// The events can be written as a Chrome trace (for chrome://tracing or
+//     Perfetto) or as folded stacks (for flamegraph.pl)
+// Recording takes a lock, which is fine as singletons are created once
+////////////////////////////////////////////////////////////////////////////////
+
+    class SingletonProfiler
+    {
+    public:
+        enum Phase
+        {
+            Construction,
+            Destruction
+        };
+
+        struct Event
+        {
+            const std::type_info* object_;
+            Phase phase_;
+            // steady_clock time
+            long long startNs_;
+            // Negative while the event is in progress
+            long long durationNs_;
+            // Small number identifying the thread, 1 for the first one seen
+            unsigned thread_;
+            // Index of the enclosing event, or -1
+            std::size_t parent_;
+            unsigned depth_;
+        };
+
+        // Opens an event on the calling thread; returns its index
+        static std::size_t Begin(const std::type_info& object, Phase phase);
+        // Closes the event opened by Begin
+        static void End(std::size_t event);
+
+        // Copy of the events recorded so far, in order of start
+        static std::vector<Event> Events();
+
+        // Chrome's trace event format, one complete ("X") event per finished
+        //     event, with times in microseconds from the first event
+        static void WriteChromeTrace(std::ostream& os);
+
+        // One line per distinct stack, "construction;Outer;Inner ns", where ns
+        //     is the time spent in Inner itself (excluding what it nested)
+        static void WriteFoldedStacks(std::ostream& os);
+
+        // Forgets all events; not to be called while singletons are being
+        //     created or destroyed
+        static void Reset();
+
+        // Records an event for the duration of a scope
+        class Scope
+        {
+        public:
+            Scope(const std::type_info& object, Phase phase)
+                : event_(Begin(object, phase))
+            {}
+
+            ~Scope()
+            { End(event_); }
+
+        private:
+            Scope(const Scope&);
+            Scope& operator=(const Scope&);
+
+            std::size_t event_;
+        };
+    };
+} // namespace Loki
+
+#endif // SINGLETONPROFILER_INC_
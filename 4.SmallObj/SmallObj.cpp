@@ -17,6 +17,7 @@
 
 #include "SmallObj.h"
 #include <cassert>
+#include <climits>
 #include <algorithm>
 #include <functional>
 
@@ -352,20 +353,6 @@ void FixedAllocator::DoDeallocate(void* p)
     }
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// SmallObjAllocator::SmallObjAllocator
-// Creates an allocator for small objects given chunk size and maximum 'small'
-//     object size
-////////////////////////////////////////////////////////////////////////////////
-
-SmallObjAllocator::SmallObjAllocator(
-        std::size_t chunkSize, 
-        std::size_t maxObjectSize)
-    : pLastAlloc_(0), pLastDealloc_(0)
-    , chunkSize_(chunkSize), maxObjectSize_(maxObjectSize) 
-{   
-}
-
 namespace { // anoymous 
 
 // See LWG DR #270
@@ -388,21 +375,30 @@ struct CompareFixedAllocatorSize
 
 void* SmallObjAllocator::Allocate(std::size_t numBytes)
 {
-    if (numBytes > maxObjectSize_) return operator new(numBytes);
-    
-    if (pLastAlloc_ && pLastAlloc_->BlockSize() == numBytes)
+    void* pResult;
+    if (numBytes > maxObjectSize_)
     {
-        return pLastAlloc_->Allocate();
+        pResult = operator new(numBytes);
     }
-    Pool::iterator i = std::lower_bound(pool_.begin(), pool_.end(), numBytes, 
-                                        CompareFixedAllocatorSize());
-    if (i == pool_.end() || i->BlockSize() != numBytes)
+    else if (pLastAlloc_ && pLastAlloc_->BlockSize() == numBytes)
     {
-        i = pool_.insert(i, FixedAllocator(numBytes));
-        pLastDealloc_ = &*pool_.begin();
+        pResult = pLastAlloc_->Allocate();
     }
-    pLastAlloc_ = &*i;
-    return pLastAlloc_->Allocate();
+    else
+    {
+        Pool::iterator i = std::lower_bound(pool_.begin(), pool_.end(), 
+                                            numBytes, 
+                                            CompareFixedAllocatorSize());
+        if (i == pool_.end() || i->BlockSize() != numBytes)
+        {
+            i = pool_.insert(i, FixedAllocator(numBytes));
+            pLastDealloc_ = &*pool_.begin();
+        }
+        pLastAlloc_ = &*i;
+        pResult = pLastAlloc_->Allocate();
+    }
+    profiler_.RecordAllocation(pResult, numBytes);
+    return pResult;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -413,6 +409,8 @@ void* SmallObjAllocator::Allocate(std::size_t numBytes)
 
 void SmallObjAllocator::Deallocate(void* p, std::size_t numBytes)
 {
+    profiler_.RecordDeallocation(p);
+    
     if (numBytes > maxObjectSize_) return operator delete(p);
 
     if (pLastDealloc_ && pLastDealloc_->BlockSize() == numBytes)
@@ -20,6 +20,7 @@
 
 #include "Threads.h"
 #include "Singleton.h"
+#include "HeapProfiler.h"
 #include <cstddef>
 #include <vector>
 
@@ -31,6 +32,15 @@
 #define MAX_SMALL_OBJECT_SIZE 64
 #endif
 
+// Where std::vector can be constant initialized (C++20), so can the allocator:
+//     SmallObject then gets it through CreateConstant, with no first use test
+#if defined(__cpp_lib_constexpr_vector) && __cpp_lib_constexpr_vector >= 201907L
+#define SMALLOBJ_CONSTANT_ALLOCATOR
+#define SMALLOBJ_CONSTEXPR constexpr
+#else
+#define SMALLOBJ_CONSTEXPR
+#endif
+
 namespace Loki
 {
 ////////////////////////////////////////////////////////////////////////////////
@@ -96,12 +106,19 @@ namespace Loki
     class SmallObjAllocator
     {
     public:
-        SmallObjAllocator(
+        SMALLOBJ_CONSTEXPR SmallObjAllocator(
             std::size_t chunkSize, 
-            std::size_t maxObjectSize);
+            std::size_t maxObjectSize)
+        : pLastAlloc_(0), pLastDealloc_(0)
+        , chunkSize_(chunkSize), maxObjectSize_(maxObjectSize)
+        {}
     
         void* Allocate(std::size_t numBytes);
         void Deallocate(void* p, std::size_t size);
+        
+        // Samples allocations to find the call sites that make the pool grow
+        HeapProfiler& Profiler()
+        { return profiler_; }
     
     private:
         SmallObjAllocator(const SmallObjAllocator&);
@@ -113,6 +130,7 @@ namespace Loki
         FixedAllocator* pLastDealloc_;
         std::size_t chunkSize_;
         std::size_t maxObjectSize_;
+        HeapProfiler profiler_;
     };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,14 +153,19 @@ namespace Loki
     			
         struct MySmallObjAllocator : public SmallObjAllocator
         {
-            MySmallObjAllocator() 
+            SMALLOBJ_CONSTEXPR MySmallObjAllocator() 
             : SmallObjAllocator(chunkSize, maxSmallObjectSize)
             {}
         };
-        // The typedef below would make things much simpler, 
-        //     but MWCW won't like it
-        // typedef SingletonHolder<MySmallObjAllocator/*, CreateStatic, 
-        //        DefaultLifetime, ThreadingModel*/> MyAllocator;
+        // A constant allocator is never destroyed, so that objects deleted
+        //     during the static destruction find it intact
+#ifdef SMALLOBJ_CONSTANT_ALLOCATOR
+        typedef SingletonHolder<MySmallObjAllocator, CreateConstant, 
+            NoDestroy> MyAllocator;
+#else
+        typedef SingletonHolder<MySmallObjAllocator, CreateStatic, 
+            PhoenixSingleton> MyAllocator;
+#endif
         
     public:
         static void* operator new(std::size_t size)
@@ -151,8 +174,7 @@ namespace Loki
             typename MyThreadingModel::Lock lock;
             (void)lock; // get rid of warning
             
-            return SingletonHolder<MySmallObjAllocator, CreateStatic, 
-                PhoenixSingleton>::Instance().Allocate(size);
+            return MyAllocator::Instance().Allocate(size);
 #else
             return ::operator new(size);
 #endif
@@ -163,12 +185,62 @@ namespace Loki
             typename MyThreadingModel::Lock lock;
             (void)lock; // get rid of warning
             
-            SingletonHolder<MySmallObjAllocator, CreateStatic, 
-                PhoenixSingleton>::Instance().Deallocate(p, size);
+            MyAllocator::Instance().Deallocate(p, size);
 #else
             ::operator delete(p);
 #endif
         }
+        
+        // Deallocates n blocks of 'size' bytes, whose objects have already
+        //     been destroyed, under a single lock (see Retire in Epoch.h)
+        static void DeallocateBatch(void* const* blocks, std::size_t n,
+            std::size_t size)
+        {
+#if (MAX_SMALL_OBJECT_SIZE != 0) && (DEFAULT_CHUNK_SIZE != 0)
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+            
+            MySmallObjAllocator& allocator = MyAllocator::Instance();
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                allocator.Deallocate(blocks[i], size);
+            }
+#else
+            (void)size;
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                ::operator delete(blocks[i]);
+            }
+#endif
+        }
+        
+        // Sets the sampling interval of the allocator's HeapProfiler
+        //     (0 disables sampling)
+        static void SetHeapSamplingInterval(std::size_t meanBytes)
+        {
+#if (MAX_SMALL_OBJECT_SIZE != 0) && (DEFAULT_CHUNK_SIZE != 0)
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+            
+            MyAllocator::Instance().Profiler().SetSamplingInterval(meanBytes);
+#else
+            (void)meanBytes;
+#endif
+        }
+        // Writes the heap profile gathered by the allocator's HeapProfiler
+        static void DumpHeapProfile(std::ostream& os, 
+            HeapProfiler::Format format = HeapProfiler::TextFormat)
+        {
+#if (MAX_SMALL_OBJECT_SIZE != 0) && (DEFAULT_CHUNK_SIZE != 0)
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+            
+            MyAllocator::Instance().Profiler().Dump(os, format);
+#else
+            (void)os;
+            (void)format;
+#endif
+        }
         virtual ~SmallObject() {}
     };
 } // namespace Loki
@@ -176,6 +248,7 @@ namespace Loki
 ////////////////////////////////////////////////////////////////////////////////
 // Change log:
 // June 20, 2001: ported by Nick Thurn to gcc 2.95.3. Kudos, Nick!!!
+// The allocator is constant initialized where std::vector allows it
 ////////////////////////////////////////////////////////////////////////////////
 
 #endif // SMALLOBJ_INC_
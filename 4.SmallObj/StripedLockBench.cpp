@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+// StripedLockable against the other ThreadingModel policies, on a large
+//     population of small objects
+// First reports how the objects spread over the lock table (how many share a
+//     stripe), then the cost of locking randomly chosen objects from 1 to N
+//     threads, along with the size each policy adds to an object
+// Build: g++ -O2 -pthread StripedLockBench.cpp
+// Usage: ./a.out [objects [locks per thread]]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Threads.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace Loki;
+
+namespace
+{
+    template <template <class> class ThreadingModel>
+    struct Node : public ThreadingModel< Node<ThreadingModel> >
+    {
+        typedef ThreadingModel< Node<ThreadingModel> > MyThreadingModel;
+
+        long value_;
+
+        Node() : value_(0)
+        {}
+    };
+
+    // Spread of the objects over the stripes: the fullest stripe, and the
+    //     chance that two distinct objects picked at random share a stripe
+    //     (1 / STRIPED_LOCK_TABLE_SIZE for a perfect hash)
+    void Collisions(std::size_t objects)
+    {
+        typedef Node<StripedLockable> Host;
+        typedef Private::LockTable<Mutex> Table;
+
+        std::vector<Host*> nodes;
+        for (std::size_t i = 0; i != objects; ++i) nodes.push_back(new Host);
+
+        std::vector<std::size_t> load(STRIPED_LOCK_TABLE_SIZE);
+        for (std::size_t i = 0; i != objects; ++i)
+        {
+            ++load[Table::Index(nodes[i])];
+        }
+        double pairs = 0;
+        for (std::size_t i = 0; i != load.size(); ++i)
+        {
+            pairs += double(load[i]) * (load[i] - (load[i] != 0));
+        }
+
+        std::printf("%lu objects of %lu bytes over %d stripes: fullest stripe "
+            "%lu (%.1f on average), collision chance %.3g (ideal %.3g)\n",
+            (unsigned long)objects, (unsigned long)sizeof(Host),
+            STRIPED_LOCK_TABLE_SIZE,
+            (unsigned long)*std::max_element(load.begin(), load.end()),
+            double(objects) / STRIPED_LOCK_TABLE_SIZE,
+            pairs / (double(objects) * (objects - 1)),
+            1.0 / STRIPED_LOCK_TABLE_SIZE);
+
+        for (std::size_t i = 0; i != objects; ++i) delete nodes[i];
+    }
+
+    // 'threads' threads each lock 'iterations' randomly chosen objects;
+    //     returns the nanoseconds per lock
+    template <template <class> class ThreadingModel>
+    double RandomLocks(std::vector< Node<ThreadingModel> >& nodes,
+        unsigned threads, unsigned long iterations)
+    {
+        typedef Node<ThreadingModel> Host;
+        std::atomic<unsigned> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t != threads; ++t)
+        {
+            pool.push_back(std::thread([&, t]()
+            {
+                unsigned long long rng = 0x9E3779B97F4A7C15ULL * (t + 1);
+                ++ready;
+                while (!go.load()) {}
+                for (unsigned long i = 0; i != iterations; ++i)
+                {
+                    rng ^= rng << 13;
+                    rng ^= rng >> 7;
+                    rng ^= rng << 17;
+                    Host& node = nodes[rng % nodes.size()];
+                    typename Host::MyThreadingModel::Lock lock(node);
+                    (void)lock;
+                    ++node.value_;
+                }
+            }));
+        }
+        while (ready.load() != threads) {}
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        go.store(true);
+        for (unsigned t = 0; t != threads; ++t) pool[t].join();
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() /
+            (double(threads) * iterations);
+    }
+
+    template <template <class> class ThreadingModel>
+    void Row(const char* name, std::size_t objects, unsigned threads,
+        unsigned long iterations)
+    {
+        std::vector< Node<ThreadingModel> > nodes(objects);
+        std::printf("%-22s %6lu", name,
+            (unsigned long)sizeof(Node<ThreadingModel>));
+        for (unsigned n = 1; n <= threads; n *= 2)
+        {
+            std::printf(" %10.2f", RandomLocks(nodes, n, iterations / n));
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t objects = argc > 1
+        ? std::strtoul(argv[1], 0, 10) : 1000000;
+    const unsigned long iterations = argc > 2
+        ? std::strtoul(argv[2], 0, 10) : 10000000;
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 2;
+
+    Collisions(objects);
+
+    std::printf("\nns/lock on random objects, 1 to %u threads\n", threads);
+    std::printf("%-22s %6s", "policy", "bytes");
+    for (unsigned n = 1; n <= threads; n *= 2) std::printf(" %10u", n);
+    std::printf("\n");
+    Row<ObjectLevelLockable>("ObjectLevelLockable", objects, threads,
+        iterations);
+    Row<ClassLevelLockable>("ClassLevelLockable", objects, threads,
+        iterations);
+    Row<StripedLockable>("StripedLockable", objects, threads, iterations);
+    return 0;
+}
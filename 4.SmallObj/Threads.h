@@ -15,6 +15,40 @@
 #define DEFAULT_THREADING /**/ ::Loki::SingleThreaded
 #endif
 
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+#ifndef _WINDOWS_
+#include <sched.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// macros PROFILE_LOCKS and LOCK_SITE
+// Defining PROFILE_LOCKS makes the POSIX policies record contention statistics
+//     for every Lock (see LockProfiler.h)
+// LOCK_SITE() attributes the locks taken in the enclosing scope to the current
+//     source line; it compiles to nothing unless PROFILE_LOCKS is defined
+////////////////////////////////////////////////////////////////////////////////
+
+#if defined(PROFILE_LOCKS) && !defined(_WINDOWS_)
+#include "LockProfiler.h"
+#include <typeinfo>
+#define LOCK_SITE_STRINGIZE_(x) #x
+#define LOCK_SITE_STRINGIZE(x) LOCK_SITE_STRINGIZE_(x)
+#define LOCK_SITE() ::Loki::ScopedLockSite lockSite_( \
+    __FILE__ ":" LOCK_SITE_STRINGIZE(__LINE__))
+#else
+#define LOCK_SITE() /**/
+#endif
+
 namespace Loki
 {
 ////////////////////////////////////////////////////////////////////////////////
@@ -60,6 +94,46 @@ namespace Loki
         
         static void AtomicAssign(IntType & lval, volatile IntType & val)
         { lval = val; }
+
+        // Same interface as AtomicOperations; the order is irrelevant here
+        template <class T>
+        static T AtomicLoad(const volatile T& val,
+            std::memory_order = std::memory_order_seq_cst)
+        { return val; }
+
+        template <class T>
+        static void AtomicStore(volatile T& lval, T val,
+            std::memory_order = std::memory_order_seq_cst)
+        { lval = val; }
+
+        template <class T>
+        static T AtomicExchange(volatile T& lval, T val,
+            std::memory_order = std::memory_order_seq_cst)
+        { T old = lval; lval = val; return old; }
+
+        template <class T>
+        static bool AtomicCompareExchange(volatile T& lval, T& expected,
+            T desired, std::memory_order = std::memory_order_seq_cst,
+            std::memory_order = std::memory_order_seq_cst)
+        {
+            if (lval != expected)
+            {
+                expected = lval;
+                return false;
+            }
+            lval = desired;
+            return true;
+        }
+
+        template <class T>
+        static T AtomicFetchAdd(volatile T& lval, T val,
+            std::memory_order = std::memory_order_seq_cst)
+        { T old = lval; lval = old + val; return old; }
+
+        template <class T>
+        static T AtomicFetchSub(volatile T& lval, T val,
+            std::memory_order = std::memory_order_seq_cst)
+        { T old = lval; lval = old - val; return old; }
     };
     
 #ifdef _WINDOWS_
@@ -188,6 +262,1099 @@ namespace Loki
     typename ClassLevelLockable<Host>::Initializer 
     ClassLevelLockable<Host>::initializer_;
     
+#else // POSIX
+
+////////////////////////////////////////////////////////////////////////////////
+// class Mutex
+// Non-recursive mutex used by the ThreadingModel policies below
+// On Linux it's built directly on a futex: an uncontended Lock/Unlock pair costs
+//     two atomic operations and no system call, and the kernel is entered only
+//     to sleep or to wake a sleeping waiter
+// Elsewhere it wraps a pthread_mutex_t
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __linux__
+
+    class Mutex
+    {
+        // 0: unlocked, 1: locked, 2: locked and there may be waiters
+        std::atomic<int> state_;
+
+        Mutex(const Mutex&);
+        Mutex& operator=(const Mutex&);
+
+        void Wait(int expected)
+        {
+            ::syscall(SYS_futex, reinterpret_cast<int*>(&state_),
+                FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+        }
+
+        void WakeOne()
+        {
+            ::syscall(SYS_futex, reinterpret_cast<int*>(&state_),
+                FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+        }
+
+        void LockSlow(int c)
+        {
+            if (c != 2) c = state_.exchange(2, std::memory_order_acquire);
+            while (c != 0)
+            {
+                Wait(2);
+                c = state_.exchange(2, std::memory_order_acquire);
+            }
+        }
+
+    public:
+        constexpr Mutex() : state_(0)
+        {}
+
+        void Lock()
+        {
+            int c = 0;
+            if (!state_.compare_exchange_strong(c, 1,
+                std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                LockSlow(c);
+            }
+        }
+
+        bool TryLock()
+        {
+            int c = 0;
+            return state_.compare_exchange_strong(c, 1,
+                std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        // A hint for spinning waiters: reading it keeps the cache line shared
+        bool IsLocked() const
+        { return state_.load(std::memory_order_relaxed) != 0; }
+
+        void Unlock()
+        {
+            if (state_.exchange(0, std::memory_order_release) == 2) WakeOne();
+        }
+    };
+
+#else // __linux__
+
+    class Mutex
+    {
+        pthread_mutex_t mtx_;
+
+        Mutex(const Mutex&);
+        Mutex& operator=(const Mutex&);
+
+    public:
+        Mutex()
+        { ::pthread_mutex_init(&mtx_, 0); }
+
+        ~Mutex()
+        { ::pthread_mutex_destroy(&mtx_); }
+
+        void Lock()
+        { ::pthread_mutex_lock(&mtx_); }
+
+        bool TryLock()
+        { return ::pthread_mutex_trylock(&mtx_) == 0; }
+
+        // The state of a pthread_mutex_t can't be read; spinners just try
+        bool IsLocked() const
+        { return false; }
+
+        void Unlock()
+        { ::pthread_mutex_unlock(&mtx_); }
+    };
+
+#endif // __linux__
+
+////////////////////////////////////////////////////////////////////////////////
+// function CpuRelax
+// Tells the processor that the caller is spinning (pause on x86, yield on ARM)
+////////////////////////////////////////////////////////////////////////////////
+
+    namespace Private
+    {
+        inline void CpuRelax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            __asm__ __volatile__("yield");
+#endif
+        }
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+// class SpinMutex
+// Test-and-test-and-set spinlock with exponential backoff
+// Waiters spin on a plain load (so the cache line stays shared until the lock
+//     is released) and back off exponentially between attempts; once the
+//     backoff is at its maximum they yield the processor, so that the spinlock
+//     degrades gracefully when threads outnumber cores
+// Meant for critical sections of a few tens of nanoseconds
+////////////////////////////////////////////////////////////////////////////////
+
+    class SpinMutex
+    {
+        enum { maxBackoff = 1024 };
+
+        std::atomic<bool> locked_;
+
+        SpinMutex(const SpinMutex&);
+        SpinMutex& operator=(const SpinMutex&);
+
+    public:
+        constexpr SpinMutex() : locked_(false)
+        {}
+
+        void Lock()
+        {
+            unsigned backoff = 1;
+            while (locked_.exchange(true, std::memory_order_acquire))
+            {
+                while (locked_.load(std::memory_order_relaxed))
+                {
+                    if (backoff == maxBackoff)
+                    {
+                        ::sched_yield();
+                        continue;
+                    }
+                    for (unsigned i = 0; i != backoff; ++i)
+                    {
+                        Private::CpuRelax();
+                    }
+                    backoff <<= 1;
+                }
+            }
+        }
+
+        bool TryLock()
+        {
+            return !locked_.load(std::memory_order_relaxed) &&
+                !locked_.exchange(true, std::memory_order_acquire);
+        }
+
+        void Unlock()
+        {
+            locked_.store(false, std::memory_order_release);
+        }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class TicketMutex
+// Fair (FIFO) spinlock: each waiter takes a ticket and spins until it's served
+// Waiters back off in proportion to their distance from the head of the queue
+//     and, like SpinMutex, yield once they have spun for long
+////////////////////////////////////////////////////////////////////////////////
+
+    class TicketMutex
+    {
+        enum { backoffPerWaiter = 64, maxSpins = 1024 };
+
+        std::atomic<unsigned> next_;
+        std::atomic<unsigned> serving_;
+
+        TicketMutex(const TicketMutex&);
+        TicketMutex& operator=(const TicketMutex&);
+
+    public:
+        constexpr TicketMutex() : next_(0), serving_(0)
+        {}
+
+        void Lock()
+        {
+            const unsigned ticket =
+                next_.fetch_add(1, std::memory_order_relaxed);
+            unsigned spun = 0;
+            for (;;)
+            {
+                const unsigned serving =
+                    serving_.load(std::memory_order_acquire);
+                if (serving == ticket) return;
+                if (spun >= maxSpins)
+                {
+                    ::sched_yield();
+                    continue;
+                }
+                const unsigned backoff = (ticket - serving) * backoffPerWaiter;
+                for (unsigned i = 0; i != backoff; ++i)
+                {
+                    Private::CpuRelax();
+                }
+                spun += backoff;
+            }
+        }
+
+        bool TryLock()
+        {
+            unsigned serving = serving_.load(std::memory_order_relaxed);
+            unsigned ticket = serving;
+            return next_.compare_exchange_strong(ticket, serving + 1,
+                std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void Unlock()
+        {
+            serving_.store(serving_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+        }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class AdaptiveMutex
+// Spins for a while (ADAPTIVE_MUTEX_SPIN_COUNT attempts) hoping the owner
+//     leaves its short critical section, then sleeps like Mutex
+// Like SpinMutex, the spinners read the lock and only try to take it when
+//     it looks free
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ADAPTIVE_MUTEX_SPIN_COUNT
+#define ADAPTIVE_MUTEX_SPIN_COUNT 100
+#endif
+
+    class AdaptiveMutex
+    {
+        Mutex mtx_;
+
+        AdaptiveMutex(const AdaptiveMutex&);
+        AdaptiveMutex& operator=(const AdaptiveMutex&);
+
+    public:
+#ifdef __linux__
+        constexpr
+#endif
+        AdaptiveMutex()
+        {}
+
+        void Lock()
+        {
+            for (unsigned i = 0; i != ADAPTIVE_MUTEX_SPIN_COUNT; ++i)
+            {
+                if (!mtx_.IsLocked() && mtx_.TryLock()) return;
+                Private::CpuRelax();
+            }
+            mtx_.Lock();
+        }
+
+        bool TryLock()
+        { return mtx_.TryLock(); }
+
+        void Unlock()
+        { mtx_.Unlock(); }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// functions FutexWait and FutexWakeAll
+// Sleep while an atomic word holds a given value, and wake all such sleepers
+// Off Linux, waiting degrades to yielding the processor
+////////////////////////////////////////////////////////////////////////////////
+
+    namespace Private
+    {
+        inline void FutexWait(std::atomic<int>& word, int expected)
+        {
+#ifdef __linux__
+            ::syscall(SYS_futex, reinterpret_cast<int*>(&word),
+                FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+#else
+            if (word.load(std::memory_order_relaxed) == expected)
+            {
+                ::sched_yield();
+            }
+#endif
+        }
+
+        inline void FutexWakeAll(std::atomic<int>& word)
+        {
+#ifdef __linux__
+            ::syscall(SYS_futex, reinterpret_cast<int*>(&word),
+                FUTEX_WAKE_PRIVATE, 0x7fffffff, 0, 0, 0);
+#else
+            (void)word;
+#endif
+        }
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+// function CurrentSlot
+// Maps the calling thread to one of 'slots' per-processor slots: its current
+//     processor where that's known, a hash of the thread otherwise
+////////////////////////////////////////////////////////////////////////////////
+
+    namespace Private
+    {
+        inline unsigned CurrentSlot(unsigned slots)
+        {
+#ifdef __linux__
+            int cpu = ::sched_getcpu();
+            if (cpu >= 0) return unsigned(cpu) % slots;
+#endif
+            static thread_local char tag;
+            return unsigned(reinterpret_cast<std::size_t>(&tag) >> 6) % slots;
+        }
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+// class template BasicRWMutex
+// Reader-writer mutex: any number of readers, or a single writer
+// With preferWriters, a waiting writer holds off newly arriving readers, so a
+//     steady stream of readers can't starve the writers; without it, readers
+//     get in whenever no writer holds the lock
+// Besides ReadLock/TryReadLock/ReadUnlock it offers Lock/TryLock/Unlock (the write side),
+//     so it plugs into the generic lockables like any other mutex
+// ReadLock returns a token to be handed back to ReadUnlock (unused here; see
+//     ScalableRWMutex)
+////////////////////////////////////////////////////////////////////////////////
+
+    template <bool preferWriters>
+    class BasicRWMutex
+    {
+        // Readers in the low bits, then the writer bit, then the number of
+        //     waiting writers
+        enum
+        {
+            readerMask = (1 << 20) - 1,
+            writerBit = 1 << 20,
+            waitingWriter = 1 << 21,
+            blockReaders = preferWriters ? ~readerMask : writerBit
+        };
+
+        std::atomic<int> state_;
+        std::atomic<int> sleepers_;
+
+        BasicRWMutex(const BasicRWMutex&);
+        BasicRWMutex& operator=(const BasicRWMutex&);
+
+        void Wait(int expected)
+        {
+            sleepers_.fetch_add(1);
+            Private::FutexWait(state_, expected);
+            sleepers_.fetch_sub(1);
+        }
+
+        void WakeAll()
+        {
+            if (sleepers_.load()) Private::FutexWakeAll(state_);
+        }
+
+    public:
+        constexpr BasicRWMutex() : state_(0), sleepers_(0)
+        {}
+
+        unsigned ReadLock()
+        {
+            for (;;)
+            {
+                int c = state_.load(std::memory_order_relaxed);
+                if (c & blockReaders)
+                {
+                    Wait(c);
+                }
+                else if (state_.compare_exchange_weak(c, c + 1,
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    return 0;
+                }
+            }
+        }
+
+        bool TryReadLock(unsigned& token)
+        {
+            int c = state_.load(std::memory_order_relaxed);
+            token = 0;
+            return !(c & blockReaders) &&
+                state_.compare_exchange_strong(c, c + 1,
+                    std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void ReadUnlock(unsigned)
+        {
+            if ((state_.fetch_sub(1) & readerMask) == 1) WakeAll();
+        }
+
+        void Lock()
+        {
+            if (TryLock()) return;
+            state_.fetch_add(waitingWriter, std::memory_order_relaxed);
+            for (;;)
+            {
+                int c = state_.load(std::memory_order_relaxed);
+                if (c & (readerMask | writerBit))
+                {
+                    Wait(c);
+                }
+                else if (state_.compare_exchange_weak(c,
+                    c - waitingWriter + writerBit,
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    return;
+                }
+            }
+        }
+
+        bool TryLock()
+        {
+            int c = state_.load(std::memory_order_relaxed);
+            return !(c & (readerMask | writerBit)) &&
+                state_.compare_exchange_strong(c, c + writerBit,
+                    std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void Unlock()
+        {
+            state_.fetch_sub(writerBit);
+            WakeAll();
+        }
+    };
+
+    typedef BasicRWMutex<true> RWMutex;
+    typedef BasicRWMutex<false> ReaderPreferringRWMutex;
+
+////////////////////////////////////////////////////////////////////////////////
+// class ScalableRWMutex
+// Reader-writer mutex whose readers don't share a counter: each reader marks
+//     itself in the slot of the processor it runs on (one cache line per
+//     slot), so read locks taken on different cores never contend
+// A writer raises a flag, which turns new readers away, then waits for every
+//     slot to drain; writes are therefore expensive, and preferred
+// Takes READ_WRITE_LOCK_SLOTS cache lines; meant for read-mostly objects, and
+//     for class-level locks
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef READ_WRITE_LOCK_SLOTS
+#define READ_WRITE_LOCK_SLOTS 64
+#endif
+
+    class ScalableRWMutex
+    {
+        struct alignas(64) Slot
+        {
+            std::atomic<int> readers_;
+        };
+
+        Slot slots_[READ_WRITE_LOCK_SLOTS];
+        alignas(64) std::atomic<int> writer_;
+        std::atomic<int> sleepers_;
+        Mutex writers_;
+
+        ScalableRWMutex(const ScalableRWMutex&);
+        ScalableRWMutex& operator=(const ScalableRWMutex&);
+
+        bool Drained() const
+        {
+            for (unsigned i = 0; i != READ_WRITE_LOCK_SLOTS; ++i)
+            {
+                if (slots_[i].readers_.load()) return false;
+            }
+            return true;
+        }
+
+    public:
+#ifdef __linux__
+        constexpr
+#endif
+        ScalableRWMutex() : slots_(), writer_(0), sleepers_(0)
+        {}
+
+        unsigned ReadLock()
+        {
+            const unsigned slot = Private::CurrentSlot(READ_WRITE_LOCK_SLOTS);
+            for (;;)
+            {
+                slots_[slot].readers_.fetch_add(1);
+                if (!writer_.load()) return slot;
+                // Back off and sleep until the writer is done
+                slots_[slot].readers_.fetch_sub(1);
+                sleepers_.fetch_add(1);
+                Private::FutexWait(writer_, 1);
+                sleepers_.fetch_sub(1);
+            }
+        }
+
+        bool TryReadLock(unsigned& slot)
+        {
+            slot = Private::CurrentSlot(READ_WRITE_LOCK_SLOTS);
+            slots_[slot].readers_.fetch_add(1);
+            if (!writer_.load()) return true;
+            slots_[slot].readers_.fetch_sub(1);
+            return false;
+        }
+
+        void ReadUnlock(unsigned slot)
+        {
+            slots_[slot].readers_.fetch_sub(1, std::memory_order_release);
+        }
+
+        void Lock()
+        {
+            writers_.Lock();
+            writer_.store(1);
+            while (!Drained())
+            {
+                ::sched_yield();
+            }
+        }
+
+        bool TryLock()
+        {
+            if (!writers_.TryLock()) return false;
+            writer_.store(1);
+            if (Drained()) return true;
+            Unlock();
+            return false;
+        }
+
+        void Unlock()
+        {
+            writer_.store(0, std::memory_order_release);
+            if (sleepers_.load()) Private::FutexWakeAll(writer_);
+            writers_.Unlock();
+        }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class AtomicOperations
+// Atomic operations with an explicit memory order on 32- and 64-bit integers
+//     (and pointers, for the loads, stores and exchanges), shared by the
+//     thread-safe ThreadingModel policies below
+// Order defaults to sequentially consistent, like the IntType operations
+////////////////////////////////////////////////////////////////////////////////
+
+    class AtomicOperations
+    {
+        template <class T>
+        static void CheckWidth()
+        {
+            static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                "atomic operations need a 32- or 64-bit type");
+        }
+
+        template <class T>
+        static void CheckIntegral()
+        {
+            CheckWidth<T>();
+            static_assert(std::is_integral<T>::value,
+                "atomic arithmetic needs an integral type");
+        }
+
+    public:
+        template <class T>
+        static T AtomicLoad(const volatile T& val,
+            std::memory_order order = std::memory_order_seq_cst)
+        {
+            CheckWidth<T>();
+            return __atomic_load_n(&val, int(order));
+        }
+
+        template <class T>
+        static void AtomicStore(volatile T& lval, T val,
+            std::memory_order order = std::memory_order_seq_cst)
+        {
+            CheckWidth<T>();
+            __atomic_store_n(&lval, val, int(order));
+        }
+
+        template <class T>
+        static T AtomicExchange(volatile T& lval, T val,
+            std::memory_order order = std::memory_order_seq_cst)
+        {
+            CheckWidth<T>();
+            return __atomic_exchange_n(&lval, val, int(order));
+        }
+
+        // On failure, stores the current value of lval into expected
+        template <class T>
+        static bool AtomicCompareExchange(volatile T& lval, T& expected,
+            T desired,
+            std::memory_order success = std::memory_order_seq_cst,
+            std::memory_order failure = std::memory_order_seq_cst)
+        {
+            CheckWidth<T>();
+            return __atomic_compare_exchange_n(&lval, &expected, desired,
+                false, int(success), int(failure));
+        }
+
+        // Return the previous value
+        template <class T>
+        static T AtomicFetchAdd(volatile T& lval, T val,
+            std::memory_order order = std::memory_order_seq_cst)
+        {
+            CheckIntegral<T>();
+            return __atomic_fetch_add(&lval, val, int(order));
+        }
+
+        template <class T>
+        static T AtomicFetchSub(volatile T& lval, T val,
+            std::memory_order order = std::memory_order_seq_cst)
+        {
+            CheckIntegral<T>();
+            return __atomic_fetch_sub(&lval, val, int(order));
+        }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class template LockHooks
+// How the Lock classes below take and release their mutex: directly, or
+//     through LockProfiler when PROFILE_LOCKS is defined
+////////////////////////////////////////////////////////////////////////////////
+
+    namespace Private
+    {
+#ifdef PROFILE_LOCKS
+        template <class Host>
+        struct LockHooks
+        {
+            typedef LockProfiler::Stamp Stamp;
+
+            template <class M>
+            static Stamp Lock(M& mtx)
+            { return LockProfiler::Lock<Host>(mtx); }
+
+            template <class M>
+            static void Unlock(M& mtx, const Stamp& stamp)
+            { LockProfiler::Unlock(mtx, stamp); }
+
+            template <class M>
+            static Stamp ReadLock(M& mtx, unsigned& token)
+            { return LockProfiler::ReadLock<Host>(mtx, token); }
+
+            template <class M>
+            static void ReadUnlock(M& mtx, unsigned token, const Stamp& stamp)
+            { LockProfiler::ReadUnlock(mtx, token, stamp); }
+        };
+#else
+        template <class Host>
+        struct LockHooks
+        {
+            struct Stamp {};
+
+            template <class M>
+            static Stamp Lock(M& mtx)
+            {
+                mtx.Lock();
+                return Stamp();
+            }
+
+            template <class M>
+            static void Unlock(M& mtx, const Stamp&)
+            { mtx.Unlock(); }
+
+            template <class M>
+            static Stamp ReadLock(M& mtx, unsigned& token)
+            {
+                token = mtx.ReadLock();
+                return Stamp();
+            }
+
+            template <class M>
+            static void ReadUnlock(M& mtx, unsigned token, const Stamp&)
+            { mtx.ReadUnlock(token); }
+        };
+#endif
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+// class template ObjectLevelMutexLockable
+// Implementation of the ThreadingModel policy used by various classes
+// Implements an object-level locking scheme on top of any MutexPolicy offering
+//     Lock, TryLock and Unlock
+// The IntType atomic operations are sequentially consistent; the ones
+//     inherited from AtomicOperations take a memory order
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host, class MutexPolicy>
+    class ObjectLevelMutexLockable : public AtomicOperations
+    {
+    protected:
+        mutable MutexPolicy mtx_;
+
+    public:
+        ObjectLevelMutexLockable()
+        {}
+
+        // A copy gets a mutex of its own
+        ObjectLevelMutexLockable(const ObjectLevelMutexLockable&)
+        {}
+
+        ObjectLevelMutexLockable& operator=(const ObjectLevelMutexLockable&)
+        { return *this; }
+
+        class Lock;
+        friend class Lock;
+        
+        class Lock
+        {
+            typedef Private::LockHooks<Host> Hooks;
+
+            ObjectLevelMutexLockable const& host_;
+            typename Hooks::Stamp stamp_;
+            
+            Lock(const Lock&);
+            Lock& operator=(const Lock&);
+        public:
+
+            explicit Lock(const ObjectLevelMutexLockable& host)
+                : host_(host), stamp_(Hooks::Lock(host_.mtx_))
+            {}
+
+            ~Lock()
+            {
+                Hooks::Unlock(host_.mtx_, stamp_);
+            }
+        };
+
+        typedef volatile Host VolatileType;
+
+        typedef int IntType; 
+
+        static IntType AtomicAdd(volatile IntType& lval, IntType val)
+        { return __atomic_add_fetch(&lval, val, __ATOMIC_SEQ_CST); }
+        
+        static IntType AtomicSubtract(volatile IntType& lval, IntType val)
+        { return __atomic_sub_fetch(&lval, val, __ATOMIC_SEQ_CST); }
+
+        static IntType AtomicIncrement(volatile IntType& lval)
+        { return __atomic_add_fetch(&lval, 1, __ATOMIC_SEQ_CST); }
+        
+        static IntType AtomicDecrement(volatile IntType& lval)
+        { return __atomic_sub_fetch(&lval, 1, __ATOMIC_SEQ_CST); }
+        
+        static void AtomicAssign(volatile IntType& lval, IntType val)
+        { __atomic_store_n(&lval, val, __ATOMIC_SEQ_CST); }
+        
+        static void AtomicAssign(IntType& lval, volatile IntType& val)
+        { lval = __atomic_load_n(&val, __ATOMIC_SEQ_CST); }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class template ClassLevelMutexLockable
+// Implementation of the ThreadingModel policy used by various classes
+// Implements a class-level locking scheme on top of any MutexPolicy offering
+//     Lock, TryLock and Unlock
+// The mutex must have a constexpr default constructor, so that it's usable
+//     during the dynamic initialization of other statics
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host, class MutexPolicy>
+    class ClassLevelMutexLockable : public AtomicOperations
+    {
+    protected:
+        static MutexPolicy mtx_;
+
+    public:
+        class Lock;
+        friend class Lock;
+        
+        class Lock
+        {
+            typedef Private::LockHooks<Host> Hooks;
+
+            typename Hooks::Stamp stamp_;
+
+            Lock(const Lock&);
+            Lock& operator=(const Lock&);
+        public:
+            Lock() : stamp_(Hooks::Lock(mtx_))
+            {}
+            explicit Lock(const ClassLevelMutexLockable&)
+                : stamp_(Hooks::Lock(mtx_))
+            {}
+            ~Lock()
+            {
+                Hooks::Unlock(mtx_, stamp_);
+            }
+        };
+
+        typedef volatile Host VolatileType;
+
+        typedef int IntType; 
+
+        static IntType AtomicAdd(volatile IntType& lval, IntType val)
+        { return __atomic_add_fetch(&lval, val, __ATOMIC_SEQ_CST); }
+        
+        static IntType AtomicSubtract(volatile IntType& lval, IntType val)
+        { return __atomic_sub_fetch(&lval, val, __ATOMIC_SEQ_CST); }
+
+        static IntType AtomicIncrement(volatile IntType& lval)
+        { return __atomic_add_fetch(&lval, 1, __ATOMIC_SEQ_CST); }
+        
+        static IntType AtomicDecrement(volatile IntType& lval)
+        { return __atomic_sub_fetch(&lval, 1, __ATOMIC_SEQ_CST); }
+        
+        static void AtomicAssign(volatile IntType& lval, IntType val)
+        { __atomic_store_n(&lval, val, __ATOMIC_SEQ_CST); }
+        
+        static void AtomicAssign(IntType& lval, volatile IntType& val)
+        { lval = __atomic_load_n(&val, __ATOMIC_SEQ_CST); }
+    };
+
+    template <class Host, class MutexPolicy>
+    MutexPolicy ClassLevelMutexLockable<Host, MutexPolicy>::mtx_;
+
+////////////////////////////////////////////////////////////////////////////////
+// class templates ObjectLevelRWMutexLockable and ClassLevelRWMutexLockable
+// Implementations of the ThreadingModel policy used by various classes, on top
+//     of a reader-writer mutex (BasicRWMutex or ScalableRWMutex)
+// Lock (also known as WriteLock) is exclusive, as with the other policies;
+//     ReadLock is shared
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host, class RWMutexPolicy>
+    class ObjectLevelRWMutexLockable
+        : public ObjectLevelMutexLockable<Host, RWMutexPolicy>
+    {
+        typedef ObjectLevelMutexLockable<Host, RWMutexPolicy> Base;
+
+    public:
+        typedef typename Base::Lock WriteLock;
+
+        class ReadLock
+        {
+            typedef Private::LockHooks<Host> Hooks;
+
+            ObjectLevelRWMutexLockable const& host_;
+            unsigned token_;
+            typename Hooks::Stamp stamp_;
+
+            ReadLock(const ReadLock&);
+            ReadLock& operator=(const ReadLock&);
+        public:
+            explicit ReadLock(const ObjectLevelRWMutexLockable& host)
+                : host_(host), token_(0),
+                stamp_(Hooks::ReadLock(host.mtx_, token_))
+            {}
+
+            ~ReadLock()
+            {
+                Hooks::ReadUnlock(host_.mtx_, token_, stamp_);
+            }
+        };
+    };
+
+    template <class Host, class RWMutexPolicy>
+    class ClassLevelRWMutexLockable
+        : public ClassLevelMutexLockable<Host, RWMutexPolicy>
+    {
+        typedef ClassLevelMutexLockable<Host, RWMutexPolicy> Base;
+
+    public:
+        typedef typename Base::Lock WriteLock;
+
+        class ReadLock
+        {
+            typedef Private::LockHooks<Host> Hooks;
+
+            unsigned token_;
+            typename Hooks::Stamp stamp_;
+
+            ReadLock(const ReadLock&);
+            ReadLock& operator=(const ReadLock&);
+        public:
+            ReadLock() : token_(0), stamp_(Hooks::ReadLock(Base::mtx_, token_))
+            {}
+
+            explicit ReadLock(const ClassLevelRWMutexLockable&)
+                : token_(0), stamp_(Hooks::ReadLock(Base::mtx_, token_))
+            {}
+
+            ~ReadLock()
+            {
+                Hooks::ReadUnlock(Base::mtx_, token_, stamp_);
+            }
+        };
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class template StripedMutexLockable
+// Implementation of the ThreadingModel policy used by various classes
+// Between object-level and class-level locking: the address of the object is
+//     hashed into a fixed table of STRIPED_LOCK_TABLE_SIZE mutexes (one cache
+//     line each), so that distinct objects rarely share a lock while the
+//     objects themselves carry no lock state at all
+// Two objects may map to the same mutex: a thread must not hold the Lock of
+//     one object while taking the Lock of another
+// There's one table per MutexPolicy, shared by all hosts
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef STRIPED_LOCK_TABLE_SIZE
+#define STRIPED_LOCK_TABLE_SIZE 1024
+#endif
+
+    namespace Private
+    {
+        template <class MutexPolicy>
+        struct LockTable
+        {
+            static_assert((STRIPED_LOCK_TABLE_SIZE &
+                (STRIPED_LOCK_TABLE_SIZE - 1)) == 0,
+                "STRIPED_LOCK_TABLE_SIZE must be a power of two");
+
+            struct alignas(64) Stripe
+            {
+                MutexPolicy mtx_;
+            };
+
+            static Stripe stripes_[STRIPED_LOCK_TABLE_SIZE];
+
+            static std::size_t Index(const volatile void* p)
+            {
+                // Fibonacci hashing of the address; the low bits are dropped
+                //     since they're mostly alignment
+                unsigned long long bits = reinterpret_cast<std::size_t>(p) >> 4;
+                bits *= 0x9E3779B97F4A7C15ULL;
+                return static_cast<std::size_t>(bits >> 32)
+                    & (STRIPED_LOCK_TABLE_SIZE - 1);
+            }
+
+            static MutexPolicy& For(const volatile void* p)
+            { return stripes_[Index(p)].mtx_; }
+        };
+
+        template <class MutexPolicy>
+        typename LockTable<MutexPolicy>::Stripe
+            LockTable<MutexPolicy>::stripes_[STRIPED_LOCK_TABLE_SIZE];
+    }
+
+    template <class Host, class MutexPolicy>
+    class StripedMutexLockable : public AtomicOperations
+    {
+        typedef Private::LockTable<MutexPolicy> Table;
+
+    public:
+        class Lock;
+        friend class Lock;
+        
+        class Lock
+        {
+            typedef Private::LockHooks<Host> Hooks;
+
+            MutexPolicy& mtx_;
+            typename Hooks::Stamp stamp_;
+
+            Lock(const Lock&);
+            Lock& operator=(const Lock&);
+        public:
+            explicit Lock(const StripedMutexLockable& host)
+                : mtx_(Table::For(&host)), stamp_(Hooks::Lock(mtx_))
+            {}
+
+            ~Lock()
+            {
+                Hooks::Unlock(mtx_, stamp_);
+            }
+        };
+
+        typedef volatile Host VolatileType;
+
+        typedef int IntType; 
+
+        static IntType AtomicAdd(volatile IntType& lval, IntType val)
+        { return __atomic_add_fetch(&lval, val, __ATOMIC_SEQ_CST); }
+        
+        static IntType AtomicSubtract(volatile IntType& lval, IntType val)
+        { return __atomic_sub_fetch(&lval, val, __ATOMIC_SEQ_CST); }
+
+        static IntType AtomicIncrement(volatile IntType& lval)
+        { return __atomic_add_fetch(&lval, 1, __ATOMIC_SEQ_CST); }
+        
+        static IntType AtomicDecrement(volatile IntType& lval)
+        { return __atomic_sub_fetch(&lval, 1, __ATOMIC_SEQ_CST); }
+        
+        static void AtomicAssign(volatile IntType& lval, IntType val)
+        { __atomic_store_n(&lval, val, __ATOMIC_SEQ_CST); }
+        
+        static void AtomicAssign(IntType& lval, volatile IntType& val)
+        { lval = __atomic_load_n(&val, __ATOMIC_SEQ_CST); }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class templates ObjectLevelLockable and ClassLevelLockable
+// Implementations of the ThreadingModel policy used by various classes
+// Same interface as their Windows counterparts, built on Mutex
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host>
+    class ObjectLevelLockable : public ObjectLevelMutexLockable<Host, Mutex>
+    {};
+
+    template <class Host>
+    class ClassLevelLockable : public ClassLevelMutexLockable<Host, Mutex>
+    {};
+
+////////////////////////////////////////////////////////////////////////////////
+// Spinning, fair and adaptive variants of ObjectLevelLockable and
+//     ClassLevelLockable, for components whose critical sections are too short
+//     to be worth parking a thread in the kernel
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host>
+    class ObjectLevelSpinLockable
+        : public ObjectLevelMutexLockable<Host, SpinMutex>
+    {};
+
+    template <class Host>
+    class ClassLevelSpinLockable
+        : public ClassLevelMutexLockable<Host, SpinMutex>
+    {};
+
+    template <class Host>
+    class ObjectLevelTicketLockable
+        : public ObjectLevelMutexLockable<Host, TicketMutex>
+    {};
+
+    template <class Host>
+    class ClassLevelTicketLockable
+        : public ClassLevelMutexLockable<Host, TicketMutex>
+    {};
+
+    template <class Host>
+    class ObjectLevelAdaptiveLockable
+        : public ObjectLevelMutexLockable<Host, AdaptiveMutex>
+    {};
+
+    template <class Host>
+    class ClassLevelAdaptiveLockable
+        : public ClassLevelMutexLockable<Host, AdaptiveMutex>
+    {};
+
+////////////////////////////////////////////////////////////////////////////////
+// Reader-writer policies, for read-mostly shared objects
+// ReadWriteLockable and ClassLevelReadWriteLockable prefer writers;
+//     the Scalable variants keep one reader slot per processor, so that read
+//     throughput scales with the number of cores
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host>
+    class ReadWriteLockable
+        : public ObjectLevelRWMutexLockable<Host, RWMutex>
+    {};
+
+    template <class Host>
+    class ClassLevelReadWriteLockable
+        : public ClassLevelRWMutexLockable<Host, RWMutex>
+    {};
+
+    template <class Host>
+    class ScalableReadWriteLockable
+        : public ObjectLevelRWMutexLockable<Host, ScalableRWMutex>
+    {};
+
+    template <class Host>
+    class ClassLevelScalableReadWriteLockable
+        : public ClassLevelRWMutexLockable<Host, ScalableRWMutex>
+    {};
+
+////////////////////////////////////////////////////////////////////////////////
+// class template StripedLockable
+// Lock striping on Mutex: near object-level concurrency for large numbers of
+//     small objects, at no per-object cost
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Host>
+    class StripedLockable : public StripedMutexLockable<Host, Mutex>
+    {};
+
 #endif    
 }
 
@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+// Measures the cost of the ThreadingModel policies of Threads.h: taking a Lock
+//     around an increment, and AtomicIncrement, uncontended and with all
+//     hardware threads hammering the same object
+// Then compares the reader-writer policies with plain locks on a read-mostly
+//     load (one write every readsPerWrite operations)
+// Finally compares a shared counter bumped with a relaxed AtomicFetchAdd with
+//     a ShardedCounter
+// Build: g++ -O2 -pthread ThreadsBench.cpp
+// Usage: ./a.out [iterations per thread]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Threads.h"
+#include "ShardedCounter.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace Loki;
+
+namespace
+{
+    template <template <class> class ThreadingModel>
+    struct Counter : public ThreadingModel< Counter<ThreadingModel> >
+    {
+        typedef ThreadingModel< Counter<ThreadingModel> > MyThreadingModel;
+
+        volatile typename MyThreadingModel::IntType value_;
+
+        Counter() : value_(0)
+        {}
+    };
+
+    // Runs fun(iterations) on 'threads' threads released together; returns the
+    //     nanoseconds per operation (wall clock time divided by the total
+    //     number of operations)
+    template <class Fun>
+    double Run(unsigned threads, unsigned long iterations, Fun fun)
+    {
+        std::atomic<unsigned> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i != threads; ++i)
+        {
+            pool.push_back(std::thread([&]()
+            {
+                ++ready;
+                while (!go.load()) {}
+                fun(iterations);
+            }));
+        }
+        while (ready.load() != threads) {}
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        go.store(true);
+        for (unsigned i = 0; i != threads; ++i) pool[i].join();
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() /
+            (double(threads) * iterations);
+    }
+
+    template <class Host>
+    struct ReadLockOf
+    {
+        typedef typename Host::MyThreadingModel::ReadLock Type;
+    };
+
+    template <class Host>
+    struct ExclusiveLockOf
+    {
+        typedef typename Host::MyThreadingModel::Lock Type;
+    };
+
+    template <template <class> class ThreadingModel>
+    double LockedIncrements(unsigned threads, unsigned long iterations)
+    {
+        typedef Counter<ThreadingModel> Host;
+        Host counter;
+        double result = Run(threads, iterations, [&](unsigned long n)
+        {
+            for (unsigned long i = 0; i != n; ++i)
+            {
+                typename Host::MyThreadingModel::Lock lock(counter);
+                (void)lock;
+                counter.value_ = counter.value_ + 1;
+            }
+        });
+        if (counter.value_ != static_cast<long>(threads * iterations))
+        {
+            std::printf("  (lost updates!)");
+        }
+        return result;
+    }
+
+    template <template <class> class ThreadingModel>
+    double AtomicIncrements(unsigned threads, unsigned long iterations)
+    {
+        typedef Counter<ThreadingModel> Host;
+        Host counter;
+        return Run(threads, iterations, [&](unsigned long n)
+        {
+            for (unsigned long i = 0; i != n; ++i)
+            {
+                Host::MyThreadingModel::AtomicIncrement(counter.value_);
+            }
+        });
+    }
+
+    const unsigned long readsPerWrite = 1000;
+
+    // Read-mostly load on 'threads' threads; reads take ReadLock (which is the
+    //     exclusive Lock for the policies without a shared mode)
+    template <class Host, class ReadLock>
+    double ReadMostly(unsigned threads, unsigned long iterations)
+    {
+        Host counter;
+        std::atomic<long> sum(0);
+        double result = Run(threads, iterations, [&](unsigned long n)
+        {
+            long local = 0;
+            for (unsigned long i = 0; i != n; ++i)
+            {
+                if (i % readsPerWrite == 0)
+                {
+                    typename Host::MyThreadingModel::Lock lock(counter);
+                    (void)lock;
+                    counter.value_ = counter.value_ + 1;
+                }
+                else
+                {
+                    ReadLock lock(counter);
+                    (void)lock;
+                    local += counter.value_;
+                }
+            }
+            sum += local;
+        });
+        return result;
+    }
+
+    template <template <class> class ThreadingModel, bool shared>
+    void ReadMostlyRow(const char* name, unsigned threads,
+        unsigned long iterations)
+    {
+        typedef Counter<ThreadingModel> Host;
+        typedef typename std::conditional<shared,
+            ReadLockOf<Host>, ExclusiveLockOf<Host> >::type::Type ReadLock;
+        std::printf("%-36s %10.2f", name,
+            ReadMostly<Host, ReadLock>(1, iterations));
+        for (unsigned n = 2; n <= threads; n *= 2)
+        {
+            std::printf(" %10.2f", ReadMostly<Host, ReadLock>(n,
+                iterations / n));
+        }
+        std::printf("\n");
+    }
+
+    double SharedCounterIncrements(unsigned threads, unsigned long iterations)
+    {
+        typedef ObjectLevelLockable<void> Model;
+        alignas(64) volatile long counter = 0;
+        double result = Run(threads, iterations, [&](unsigned long n)
+        {
+            for (unsigned long i = 0; i != n; ++i)
+            {
+                Model::AtomicFetchAdd(counter, 1L, std::memory_order_relaxed);
+            }
+        });
+        if (counter != static_cast<long>(threads * iterations))
+        {
+            std::printf("  (lost updates!)");
+        }
+        return result;
+    }
+
+    double ShardedCounterIncrements(unsigned threads, unsigned long iterations)
+    {
+        static ShardedCounter<> counter;
+        counter.Reset();
+        double result = Run(threads, iterations, [&](unsigned long n)
+        {
+            for (unsigned long i = 0; i != n; ++i)
+            {
+                counter.Increment();
+            }
+        });
+        if (counter.Load() != static_cast<long>(threads * iterations))
+        {
+            std::printf("  (lost updates!)");
+        }
+        return result;
+    }
+
+    void CounterRow(const char* name,
+        double (*fun)(unsigned, unsigned long), unsigned threads,
+        unsigned long iterations)
+    {
+        std::printf("%-36s %10.2f", name, fun(1, iterations));
+        for (unsigned n = 2; n <= threads; n *= 2)
+        {
+            std::printf(" %10.2f", fun(n, iterations / n));
+        }
+        std::printf("\n");
+    }
+
+    // Prints one row of the table; single-threaded models are only measured
+    //     with one thread
+    template <template <class> class ThreadingModel>
+    void Row(const char* name, bool threadSafe, unsigned threads,
+        unsigned long iterations)
+    {
+        std::printf("%-28s %10.2f", name,
+            LockedIncrements<ThreadingModel>(1, iterations));
+        if (threadSafe)
+        {
+            std::printf(" %10.2f", LockedIncrements<ThreadingModel>(threads,
+                iterations / threads));
+        }
+        else
+        {
+            std::printf(" %10s", "-");
+        }
+        std::printf(" %10.2f", AtomicIncrements<ThreadingModel>(1, iterations));
+        if (threadSafe)
+        {
+            std::printf(" %10.2f", AtomicIncrements<ThreadingModel>(threads,
+                iterations / threads));
+        }
+        else
+        {
+            std::printf(" %10s", "-");
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned long iterations = argc > 1
+        ? std::strtoul(argv[1], 0, 10) : 10000000;
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 2;
+
+    std::printf("ns/op, %u threads when contended\n", threads);
+    std::printf("%-28s %10s %10s %10s %10s\n", "policy",
+        "lock", "lock xN", "atomic", "atomic xN");
+
+    Row<SingleThreaded>("SingleThreaded", false, threads, iterations);
+    Row<ObjectLevelLockable>("ObjectLevelLockable", true, threads, iterations);
+    Row<ClassLevelLockable>("ClassLevelLockable", true, threads, iterations);
+    Row<ClassLevelSpinLockable>("ClassLevelSpinLockable", true, threads,
+        iterations);
+    Row<ClassLevelTicketLockable>("ClassLevelTicketLockable", true, threads,
+        iterations);
+    Row<ClassLevelAdaptiveLockable>("ClassLevelAdaptiveLockable", true,
+        threads, iterations);
+
+    std::printf("\nread-mostly, ns/op, 1 to %u threads\n", threads);
+    std::printf("%-36s %10s", "policy", "1");
+    for (unsigned n = 2; n <= threads; n *= 2) std::printf(" %10u", n);
+    std::printf("\n");
+    ReadMostlyRow<ObjectLevelLockable, false>("ObjectLevelLockable",
+        threads, iterations);
+    ReadMostlyRow<ReadWriteLockable, true>("ReadWriteLockable",
+        threads, iterations);
+    ReadMostlyRow<ScalableReadWriteLockable, true>(
+        "ScalableReadWriteLockable", threads, iterations);
+    ReadMostlyRow<ClassLevelScalableReadWriteLockable, true>(
+        "ClassLevelScalableReadWriteLockable", threads, iterations);
+
+    std::printf("\ncounters, ns/increment, 1 to %u threads\n", threads);
+    std::printf("%-36s %10s", "counter", "1");
+    for (unsigned n = 2; n <= threads; n *= 2) std::printf(" %10u", n);
+    std::printf("\n");
+    CounterRow("AtomicFetchAdd (relaxed)", SharedCounterIncrements, threads,
+        iterations);
+    CounterRow("ShardedCounter", ShardedCounterIncrements, threads,
+        iterations);
+    return 0;
+}
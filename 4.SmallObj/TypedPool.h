@@ -0,0 +1,218 @@
+#ifndef TYPEDPOOL_INC_
+#define TYPEDPOOL_INC_
+
+#include "SmallObj.h"
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#ifndef MAX_RECYCLED_OBJECTS
+#define MAX_RECYCLED_OBJECTS 64
+#endif
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// class template TypedPool
+// Offers fast allocations for objects of a single type T
+// The block size (sizeof(T)) is known at compile time, so every TypedPool
+//     binds straight to its own FixedAllocator and skips the size-class search
+//     performed by SmallObjAllocator
+// Optionally recycles constructed objects: Recycle() keeps an object alive and
+//     Create() hands it out again after calling its Reset() member function
+////////////////////////////////////////////////////////////////////////////////
+
+    template
+    <
+        class T,
+        template <class> class ThreadingModel = DEFAULT_THREADING,
+        std::size_t maxRecycled = MAX_RECYCLED_OBJECTS
+    >
+    class TypedPool : public ThreadingModel<
+        TypedPool<T, ThreadingModel, maxRecycled> >
+    {
+        typedef ThreadingModel< TypedPool<T, ThreadingModel,
+                maxRecycled> > MyThreadingModel;
+
+        // FixedAllocator blocks are laid out back to back in storage obtained
+        //     from new[], so any alignment beyond the fundamental one is lost
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+            "TypedPool does not support over-aligned types");
+        // FixedAllocator puts DEFAULT_CHUNK_SIZE / sizeof(T) blocks in a chunk;
+        //     bigger objects would need more blocks than it can count
+        static_assert(sizeof(T) <= DEFAULT_CHUNK_SIZE,
+            "TypedPool does not support objects above DEFAULT_CHUNK_SIZE");
+
+        struct MyFixedAllocator : public FixedAllocator
+        {
+            MyFixedAllocator() : FixedAllocator(sizeof(T))
+            {}
+        };
+        typedef SingletonHolder<MyFixedAllocator, CreateStatic,
+            PhoenixSingleton> MyAllocator;
+
+        // Holds the objects waiting to be handed out again by Create()
+        // Creates the allocator first, so that it's destroyed after the bin
+        //     has given the objects back to it
+        struct RecycleBin
+        {
+            std::vector<T*> objects_;
+
+            RecycleBin()
+            { MyAllocator::Instance(); }
+
+            ~RecycleBin()
+            {
+                typename std::vector<T*>::iterator i = objects_.begin();
+                for (; i != objects_.end(); ++i)
+                {
+                    Destroy(*i);
+                }
+            }
+        };
+        typedef SingletonHolder<RecycleBin, CreateStatic,
+            PhoenixSingleton> MyRecycleBin;
+
+        static void Destroy(T* p)
+        {
+            p->~T();
+            MyAllocator::Instance().Deallocate(p);
+        }
+
+    public:
+        // Allocates raw memory for one T
+        static void* Allocate()
+        {
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+
+            return MyAllocator::Instance().Allocate();
+        }
+
+        // Deallocates memory previously obtained with Allocate()
+        // (if that's not the case, the behavior is undefined)
+        static void Deallocate(void* p)
+        {
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+
+            MyAllocator::Instance().Deallocate(p);
+        }
+
+        // Returns a recycled object (after calling its Reset()) or, if none is
+        //     available, a default-constructed one
+        // A recycled object whose Reset() throws is destroyed
+        static T* Create()
+        {
+            {
+                typename MyThreadingModel::Lock lock;
+                (void)lock; // get rid of warning
+
+                std::vector<T*>& objects = MyRecycleBin::Instance().objects_;
+                if (!objects.empty())
+                {
+                    T* pResult = objects.back();
+                    objects.pop_back();
+                    try
+                    {
+                        pResult->Reset();
+                    }
+                    catch (...)
+                    {
+                        Destroy(pResult);
+                        throw;
+                    }
+                    return pResult;
+                }
+            }
+            void* p = Allocate();
+            try
+            {
+                return ::new(p) T;
+            }
+            catch (...)
+            {
+                Deallocate(p);
+                throw;
+            }
+        }
+
+        // Gives an object obtained with Create() back to the pool; the object
+        //     stays constructed unless the pool already holds maxRecycled
+        //     objects, in which case it's destroyed
+        static void Recycle(T* p)
+        {
+            if (!p) return;
+
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+
+            std::vector<T*>& objects = MyRecycleBin::Instance().objects_;
+            if (objects.size() < maxRecycled)
+            {
+                objects.push_back(p);
+                return;
+            }
+            Destroy(p);
+        }
+
+        // Destroys all the objects waiting to be recycled
+        static void Purge()
+        {
+            typename MyThreadingModel::Lock lock;
+            (void)lock; // get rid of warning
+
+            std::vector<T*>& objects = MyRecycleBin::Instance().objects_;
+            while (!objects.empty())
+            {
+                Destroy(objects.back());
+                objects.pop_back();
+            }
+        }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// class template PooledObject
+// Base class for (non-polymorphic) objects of type T that want their operator
+//     new/delete to go straight to TypedPool<T>
+// Usage: class Node : public PooledObject<Node> { ... };
+// Classes derived from T have a different size and fall back to the global
+//     operator new
+////////////////////////////////////////////////////////////////////////////////
+
+    template
+    <
+        class T,
+        template <class> class ThreadingModel = DEFAULT_THREADING,
+        std::size_t maxRecycled = MAX_RECYCLED_OBJECTS
+    >
+    class PooledObject
+    {
+    public:
+        typedef TypedPool<T, ThreadingModel, maxRecycled> Pool;
+
+        static void* operator new(std::size_t size)
+        {
+            if (size != sizeof(T)) return ::operator new(size);
+            return Pool::Allocate();
+        }
+        static void operator delete(void* p, std::size_t size)
+        {
+            if (size != sizeof(T)) return ::operator delete(p);
+            Pool::Deallocate(p);
+        }
+
+        // Recycling interface, see TypedPool::Create and TypedPool::Recycle
+        static T* Create()
+        { return Pool::Create(); }
+
+        static void Recycle(T* p)
+        { Pool::Recycle(p); }
+
+    protected:
+        ~PooledObject() {}
+    };
+} // namespace Loki
+
+#endif // TYPEDPOOL_INC_
@@ -0,0 +1,382 @@
+#include "WarmUp.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <cxxabi.h>
+
+using namespace Loki;
+
+namespace // anoymous
+{
+    struct Registration
+    {
+        const std::type_info* object_;
+        WarmUpFn fun_;
+        bool threadSafe_;
+        std::vector<WarmUpFn> deps_;
+        // Taken by a WarmUp call
+        bool claimed_;
+    };
+
+    // Leaked, so that registrations made during static initialization and
+    //     WarmUp calls made during static destruction both find it
+    struct Registry
+    {
+        std::mutex mutex_;
+        std::vector<Registration> registrations_;
+    };
+
+    Registry& TheRegistry()
+    {
+        static Registry* pRegistry = new Registry;
+        return *pRegistry;
+    }
+
+    // One object to create, with the indices of its dependencies and
+    //     dependents among the objects of the same WarmUp call
+    struct Job
+    {
+        const std::type_info* object_;
+        WarmUpFn fun_;
+        // Run while no other job is
+        bool serial_;
+        std::vector<std::size_t> deps_;
+        std::vector<std::size_t> dependents_;
+        std::size_t waiting_;
+        double startMs_;
+        double durationMs_;
+        unsigned thread_;
+    };
+
+    std::string Demangle(const char* name)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name, 0, 0, &status);
+        if (!demangled) return name;
+        std::string result(demangled);
+        std::free(demangled);
+        return result;
+    }
+
+    // Kahn's algorithm; returns the jobs in an order where dependencies come
+    //     first, or throws if they form a cycle
+    std::vector<std::size_t> TopologicalOrder(const std::vector<Job>& jobs)
+    {
+        std::vector<std::size_t> waiting(jobs.size());
+        std::vector<std::size_t> order;
+        for (std::size_t i = 0; i != jobs.size(); ++i)
+        {
+            waiting[i] = jobs[i].deps_.size();
+            if (!waiting[i]) order.push_back(i);
+        }
+        for (std::size_t k = 0; k != order.size(); ++k)
+        {
+            const std::vector<std::size_t>& next = jobs[order[k]].dependents_;
+            for (std::size_t j = 0; j != next.size(); ++j)
+            {
+                if (!--waiting[next[j]]) order.push_back(next[j]);
+            }
+        }
+        if (order.size() != jobs.size())
+        {
+            for (std::size_t i = 0; i != jobs.size(); ++i)
+            {
+                if (waiting[i])
+                {
+                    throw std::logic_error("Dependency cycle in the warm-up "
+                        "of " + Demangle(jobs[i].object_->name()));
+                }
+            }
+        }
+        return order;
+    }
+
+    // Runs the jobs, each once its dependencies are done, and the serial ones
+    //     alone
+    class Scheduler
+    {
+    public:
+        explicit Scheduler(std::vector<Job>& jobs)
+            : jobs_(jobs), remaining_(jobs.size()), running_(0)
+            , serialRunning_(false), failed_(false)
+            , start_(std::chrono::steady_clock::now())
+        {
+            for (std::size_t i = 0; i != jobs_.size(); ++i)
+            {
+                if (!jobs_[i].waiting_) ready_.push_back(i);
+            }
+        }
+
+        void Work(unsigned thread)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;)
+            {
+                std::deque<std::size_t>::iterator next = ready_.end();
+                cv_.wait(lock, [&]()
+                {
+                    next = Next();
+                    return next != ready_.end() || !remaining_ || failed_;
+                });
+                if (!remaining_ || failed_) return;
+
+                Job& job = jobs_[*next];
+                ready_.erase(next);
+                job.thread_ = thread;
+                ++running_;
+                serialRunning_ = job.serial_;
+                lock.unlock();
+
+                const std::chrono::steady_clock::time_point start =
+                    std::chrono::steady_clock::now();
+                std::exception_ptr error;
+                try
+                {
+                    job.fun_();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                const std::chrono::steady_clock::time_point end =
+                    std::chrono::steady_clock::now();
+
+                lock.lock();
+                job.startMs_ = Ms(start - start_);
+                job.durationMs_ = Ms(end - start);
+                if (error)
+                {
+                    if (!failed_) error_ = error;
+                    failed_ = true;
+                }
+                for (std::size_t j = 0; j != job.dependents_.size(); ++j)
+                {
+                    std::size_t dependent = job.dependents_[j];
+                    if (!--jobs_[dependent].waiting_)
+                    {
+                        ready_.push_back(dependent);
+                    }
+                }
+                --running_;
+                serialRunning_ = false;
+                --remaining_;
+                cv_.notify_all();
+            }
+        }
+
+        std::exception_ptr Error() const
+        { return error_; }
+
+        double ElapsedMs() const
+        { return Ms(std::chrono::steady_clock::now() - start_); }
+
+    private:
+        // The first ready job that can start now: any job but a serial one
+        //     while nothing runs, else the first job that isn't serial
+        std::deque<std::size_t>::iterator Next()
+        {
+            if (serialRunning_) return ready_.end();
+            std::deque<std::size_t>::iterator i = ready_.begin();
+            if (!running_) return i;
+            while (i != ready_.end() && jobs_[*i].serial_) ++i;
+            return i;
+        }
+
+        static double Ms(std::chrono::steady_clock::duration d)
+        { return std::chrono::duration<double, std::milli>(d).count(); }
+
+        std::vector<Job>& jobs_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::size_t> ready_;
+        std::size_t remaining_;
+        unsigned running_;
+        bool serialRunning_;
+        bool failed_;
+        std::exception_ptr error_;
+        const std::chrono::steady_clock::time_point start_;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function Private::RegisterWarmUp
+////////////////////////////////////////////////////////////////////////////////
+
+void Loki::Private::RegisterWarmUp(const std::type_info& object, WarmUpFn fun,
+    bool threadSafe, const WarmUpFn* deps, std::size_t n)
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    std::vector<Registration>& all = registry.registrations_;
+    std::size_t i = 0;
+    while (i != all.size() && all[i].fun_ != fun) ++i;
+    if (i == all.size())
+    {
+        Registration registration = { &object, fun, threadSafe,
+            std::vector<WarmUpFn>(), false };
+        all.push_back(registration);
+    }
+    all[i].deps_.insert(all[i].deps_.end(), deps, deps + n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// function WarmUp
+////////////////////////////////////////////////////////////////////////////////
+
+WarmUpReport Loki::WarmUp(unsigned threads)
+{
+    std::vector<Job> jobs;
+    {
+        Registry& registry = TheRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex_);
+        std::vector<Registration>& all = registry.registrations_;
+        std::vector<std::size_t> index(all.size(), std::size_t(-1));
+        for (std::size_t i = 0; i != all.size(); ++i)
+        {
+            if (all[i].claimed_) continue;
+            index[i] = jobs.size();
+            Job job = { all[i].object_, all[i].fun_, !all[i].threadSafe_,
+                std::vector<std::size_t>(), std::vector<std::size_t>(),
+                0, 0, 0, 0 };
+            jobs.push_back(job);
+        }
+        // Dependencies that aren't registered, or are warmed up already,
+        //     don't hold anything back
+        for (std::size_t i = 0; i != all.size(); ++i)
+        {
+            if (all[i].claimed_) continue;
+            Job& job = jobs[index[i]];
+            for (std::size_t d = 0; d != all[i].deps_.size(); ++d)
+            {
+                std::size_t k = 0;
+                while (k != all.size() && all[k].fun_ != all[i].deps_[d]) ++k;
+                if (k == all.size() || all[k].claimed_) continue;
+                if (std::find(job.deps_.begin(), job.deps_.end(), index[k])
+                    != job.deps_.end()) continue;
+                job.deps_.push_back(index[k]);
+                jobs[index[k]].dependents_.push_back(index[i]);
+            }
+            job.waiting_ = job.deps_.size();
+        }
+        // Nothing is claimed if this throws
+        TopologicalOrder(jobs);
+        for (std::size_t i = 0; i != all.size(); ++i) all[i].claimed_ = true;
+    }
+
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (threads > jobs.size()) threads = static_cast<unsigned>(jobs.size());
+
+    WarmUpReport report;
+    report.threads_ = threads;
+    Scheduler scheduler(jobs);
+    if (!jobs.empty())
+    {
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t)
+        {
+            pool.push_back(std::thread(&Scheduler::Work, &scheduler, t));
+        }
+        scheduler.Work(0);
+        for (std::size_t t = 0; t != pool.size(); ++t) pool[t].join();
+    }
+    report.totalMs_ = scheduler.ElapsedMs();
+    if (scheduler.Error()) std::rethrow_exception(scheduler.Error());
+
+    // Longest chain of construction times, computed in dependency order
+    const std::vector<std::size_t> order = TopologicalOrder(jobs);
+    std::vector<double> chainMs(jobs.size());
+    std::vector<std::size_t> previous(jobs.size(), std::size_t(-1));
+    std::size_t last = std::size_t(-1);
+    for (std::size_t k = 0; k != order.size(); ++k)
+    {
+        const std::size_t i = order[k];
+        for (std::size_t d = 0; d != jobs[i].deps_.size(); ++d)
+        {
+            const std::size_t dep = jobs[i].deps_[d];
+            if (previous[i] == std::size_t(-1) ||
+                chainMs[dep] > chainMs[previous[i]])
+            {
+                previous[i] = dep;
+            }
+        }
+        chainMs[i] = jobs[i].durationMs_;
+        if (previous[i] != std::size_t(-1)) chainMs[i] += chainMs[previous[i]];
+        if (last == std::size_t(-1) || chainMs[i] > chainMs[last]) last = i;
+    }
+
+    std::vector<std::size_t> path;
+    for (std::size_t i = last; i != std::size_t(-1); i = previous[i])
+    {
+        path.push_back(i);
+    }
+    std::reverse(path.begin(), path.end());
+    if (last != std::size_t(-1)) report.criticalPathMs_ = chainMs[last];
+
+    // Tasks sorted by start; the path is remapped to the sorted indices
+    std::vector<std::size_t> byStart(jobs.size());
+    for (std::size_t i = 0; i != jobs.size(); ++i) byStart[i] = i;
+    std::stable_sort(byStart.begin(), byStart.end(),
+        [&](std::size_t lhs, std::size_t rhs)
+        { return jobs[lhs].startMs_ < jobs[rhs].startMs_; });
+    std::vector<std::size_t> rank(jobs.size());
+    for (std::size_t k = 0; k != byStart.size(); ++k)
+    {
+        const Job& job = jobs[byStart[k]];
+        WarmUpReport::Task task = { Demangle(job.object_->name()),
+            job.startMs_, job.durationMs_, job.thread_ };
+        report.tasks_.push_back(task);
+        rank[byStart[k]] = k;
+    }
+    for (std::size_t k = 0; k != path.size(); ++k)
+    {
+        report.criticalPath_.push_back(rank[path[k]]);
+    }
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// WarmUpReport::Print
+////////////////////////////////////////////////////////////////////////////////
+
+void WarmUpReport::Print(std::ostream& os) const
+{
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    double sumMs = 0;
+    for (std::size_t i = 0; i != tasks_.size(); ++i)
+    {
+        sumMs += tasks_[i].durationMs_;
+    }
+    os << std::fixed << std::setprecision(3)
+       << "Singleton warm-up: " << tasks_.size() << " objects on " << threads_
+       << " threads in " << totalMs_ << " ms (constructors took " << sumMs
+       << " ms in all, critical path " << criticalPathMs_ << " ms)\n"
+       << std::setw(12) << "start ms" << std::setw(12) << "took ms"
+       << std::setw(8) << "thread" << "  object\n";
+    for (std::size_t i = 0; i != tasks_.size(); ++i)
+    {
+        os << std::setw(12) << tasks_[i].startMs_
+           << std::setw(12) << tasks_[i].durationMs_
+           << std::setw(8) << tasks_[i].thread_
+           << "  " << tasks_[i].name_ << '\n';
+    }
+    os << "Critical path:\n";
+    for (std::size_t i = 0; i != criticalPath_.size(); ++i)
+    {
+        const Task& task = tasks_[criticalPath_[i]];
+        os << std::setw(12) << "" << std::setw(12) << task.durationMs_
+           << std::setw(8) << "" << "  " << task.name_ << '\n';
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
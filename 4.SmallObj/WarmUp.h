@@ -0,0 +1,143 @@
+#ifndef WARMUP_INC_
+#define WARMUP_INC_
+
+#include "Singleton.h"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace Loki
+{
+////////////////////////////////////////////////////////////////////////////////
+// Eager warm-up of singletons
+// SingletonHolder creates its object at the first call to Instance(), so the
+//     first request served pays for every expensive constructor. The objects
+//     registered with RegisterWarmUp are instead created by WarmUp(), on a
+//     pool of threads, before the traffic arrives
+// A registration names the holders whose objects must exist first; WarmUp
+//     starts an object as soon as its dependencies are done, so independent
+//     objects get created concurrently
+// A dependency that isn't registered itself is ignored: whoever needs it
+//     creates it lazily, as before
+// An object whose SingletonHolder is SingleThreaded (the default) is created
+//     while nothing else is, since its holder doesn't lock: the others are
+//     created concurrently. A holder that isn't a SingletonHolder is taken to
+//     be thread-safe
+// Holder is a SingletonHolder, or any class with a static Instance()
+////////////////////////////////////////////////////////////////////////////////
+
+    typedef void (*WarmUpFn)();
+
+    namespace Private
+    {
+        template <class Holder>
+        void WarmUpInstance()
+        { Holder::Instance(); }
+
+        // The type named in the reports, and whether Instance() may be
+        //     called from several threads at once
+        template <class Holder>
+        struct WarmUpObject
+        {
+            typedef Holder Type;
+            enum { threadSafe = true };
+        };
+
+        template
+        <
+            typename T,
+            template <class> class CreationPolicy,
+            template <class> class LifetimePolicy,
+            template <class> class ThreadingModel
+        >
+        struct WarmUpObject<SingletonHolder<T, CreationPolicy, LifetimePolicy,
+            ThreadingModel> >
+        {
+            typedef T Type;
+            enum { threadSafe = !std::is_same<ThreadingModel<T>,
+                SingleThreaded<T> >::value };
+        };
+
+        void RegisterWarmUp(const std::type_info& object, WarmUpFn fun,
+            bool threadSafe, const WarmUpFn* deps, std::size_t n);
+    }
+
+    // Registers Holder's object for warm-up, after the objects of Deps;
+    //     registering a holder again adds to its dependencies
+    template <class Holder, class... Deps>
+    void RegisterWarmUp()
+    {
+        typedef Private::WarmUpObject<Holder> Object;
+        const WarmUpFn deps[] = { &Private::WarmUpInstance<Deps>..., 0 };
+        Private::RegisterWarmUp(typeid(typename Object::Type),
+            &Private::WarmUpInstance<Holder>, Object::threadSafe != 0, deps,
+            sizeof...(Deps));
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+// class template WarmUpRegistration
+// Registers at static initialization time, when defined at namespace scope:
+//     static Loki::WarmUpRegistration<DbHolder, ConfigHolder> dbWarmUp;
+////////////////////////////////////////////////////////////////////////////////
+
+    template <class Holder, class... Deps>
+    struct WarmUpRegistration
+    {
+        WarmUpRegistration()
+        { RegisterWarmUp<Holder, Deps...>(); }
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// struct WarmUpReport
+// What WarmUp did: when each object was created, how long it took and on
+//     which thread, plus the critical path, i.e. the chain of dependencies
+//     with the longest total construction time, which bounds the startup time
+//     however many threads are used
+////////////////////////////////////////////////////////////////////////////////
+
+    struct WarmUpReport
+    {
+        struct Task
+        {
+            std::string name_;
+            // Milliseconds since the start of WarmUp
+            double startMs_;
+            double durationMs_;
+            unsigned thread_;
+        };
+
+        WarmUpReport() : threads_(0), totalMs_(0), criticalPathMs_(0)
+        {}
+
+        // Writes a table of the tasks and the critical path
+        void Print(std::ostream& os) const;
+
+        unsigned threads_;
+        double totalMs_;
+        double criticalPathMs_;
+        // In order of start
+        std::vector<Task> tasks_;
+        // Indices into tasks_, first dependency first
+        std::vector<std::size_t> criticalPath_;
+    };
+
+////////////////////////////////////////////////////////////////////////////////
+// function WarmUp
+// Creates the registered objects not warmed up yet, on 'threads' threads (0
+//     for one per hardware thread, the calling thread included)
+// A dependency that isn't registered may be created by two objects at once,
+//     so its holder must lock (ClassLevelLockable) if those objects' holders
+//     do: WarmUp can only see the holders registered
+// Throws std::logic_error on a dependency cycle (before creating anything),
+//     and rethrows the first exception thrown by a constructor once the
+//     objects being created are done; the objects not started then are left
+//     to lazy creation
+////////////////////////////////////////////////////////////////////////////////
+
+    WarmUpReport WarmUp(unsigned threads = 0);
+} // namespace Loki
+
+#endif // WARMUP_INC_
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+// Eager warm-up of singletons whose constructors are slow (they sleep, as if
+//     they were loading files or opening connections)
+// Config is needed by everything; Plugins, Metrics and Cache are then
+//     independent, and their holders lock, so they're created concurrently.
+//     Index and Session have the default SingleThreaded holders and both use
+//     Logger without declaring it: WarmUp creates them one at a time, so
+//     Logger is created once. Checks that each object is created once, then
+//     prints the report
+// Build: g++ -O2 -pthread WarmUpBench.cpp WarmUp.cpp Singleton.cpp
+// Usage: ./a.out [threads (0 for one per hardware thread) [ms per
+//     constructor]]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "WarmUp.h"
+#include "Threads.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace Loki;
+
+namespace // anoymous
+{
+    unsigned ms = 20;
+
+    // Constructions of each object, to spot a double creation
+    template <int id>
+    struct Slow
+    {
+        static std::atomic<unsigned> constructed;
+
+        Slow()
+        {
+            ++constructed;
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        }
+    };
+
+    template <int id>
+    std::atomic<unsigned> Slow<id>::constructed(0);
+
+    struct Config : Slow<0> {};
+    struct Logger : Slow<1> {};
+    struct Plugins : Slow<2> {};
+    struct Metrics : Slow<3> {};
+    struct Cache : Slow<4> {};
+
+    typedef SingletonHolder<Config, CreateUsingNew, DefaultLifetime,
+        ClassLevelLockable> ConfigHolder;
+    typedef SingletonHolder<Plugins, CreateUsingNew, DefaultLifetime,
+        ClassLevelLockable> PluginsHolder;
+    typedef SingletonHolder<Metrics, CreateUsingNew, DefaultLifetime,
+        ClassLevelLockable> MetricsHolder;
+    typedef SingletonHolder<Cache, CreateUsingNew, DefaultLifetime,
+        ClassLevelLockable> CacheHolder;
+    typedef SingletonHolder<Logger> LoggerHolder;
+
+    struct Index : Slow<5>
+    {
+        Index()
+        { LoggerHolder::Instance(); }
+    };
+
+    struct Session : Slow<6>
+    {
+        Session()
+        { LoggerHolder::Instance(); }
+    };
+
+    typedef SingletonHolder<Index> IndexHolder;
+    typedef SingletonHolder<Session> SessionHolder;
+
+    WarmUpRegistration<ConfigHolder> configWarmUp;
+    WarmUpRegistration<PluginsHolder, ConfigHolder> pluginsWarmUp;
+    WarmUpRegistration<MetricsHolder, ConfigHolder> metricsWarmUp;
+    WarmUpRegistration<CacheHolder, ConfigHolder> cacheWarmUp;
+    WarmUpRegistration<IndexHolder, ConfigHolder> indexWarmUp;
+    WarmUpRegistration<SessionHolder, ConfigHolder> sessionWarmUp;
+
+    bool Check(const char* name, unsigned constructed)
+    {
+        if (constructed == 1) return true;
+        std::printf("%s constructed %u times\n", name, constructed);
+        return false;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const unsigned threads = argc > 1 ? std::atoi(argv[1]) : 0;
+    if (argc > 2) ms = std::atoi(argv[2]);
+
+    const WarmUpReport report = WarmUp(threads);
+    report.Print(std::cout);
+
+    const bool ok = Check("Config", Config::constructed) &
+        Check("Logger", Logger::constructed) &
+        Check("Plugins", Plugins::constructed) &
+        Check("Metrics", Metrics::constructed) &
+        Check("Cache", Cache::constructed) &
+        Check("Index", Index::constructed) &
+        Check("Session", Session::constructed);
+    return ok ? 0 : 1;
+}
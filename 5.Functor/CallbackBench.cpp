@@ -0,0 +1,472 @@
+////////////////////////////////////////////////////////////////////////////////
+// Where a callback spends its time: building one, copying one, calling one,
+//     binding its first argument and chaining two of them, for Functor,
+//     SharedFunctor, Delegate, BindFirst and Chain versus std::function,
+//     std::bind, lambdas and direct calls, with free functions, function
+//     objects, member functions, bound and chained callbacks as targets
+// For each operation prints
+//     ns/op     wall time
+//     heap/op   calls to the global operator new
+//     small/op  calls to SmallObject's operator new, which is where the
+//               Functor implementations that don't fit inline go (counted by
+//               a ThreadingModel whose Lock counts); those bigger than
+//               MAX_SMALL_OBJECT_SIZE go on to the global operator new, and
+//               show under heap/op too
+//     code      bytes of machine code of the loop that does the operation,
+//               read from the executable's symbol table (ELF only; "-" if
+//               stripped); functions it calls rather than inlines don't count
+// Every object is reached through a volatile pointer, so that the compiler
+//     can't see what it holds
+// Build: g++ -O2 -pthread CallbackBench.cpp ../4.SmallObj/SmallObj.cpp
+//     ../4.SmallObj/Singleton.cpp ../4.SmallObj/HeapProfiler.cpp -ldl
+// Usage: ./a.out [operations]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Functor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+#include <dlfcn.h>
+#include <link.h>
+
+namespace
+{
+    unsigned long heapAllocations;
+    unsigned long smallObjectLocks;
+
+    // SingleThreaded, counting the locks that SmallObject takes in its
+    //     operator new and operator delete
+    template <class Host>
+    class CountingThreaded : public Loki::SingleThreaded<Host>
+    {
+    public:
+        struct Lock
+        {
+            Lock()
+            { ++smallObjectLocks; }
+
+            explicit Lock(const CountingThreaded&)
+            { ++smallObjectLocks; }
+        };
+    };
+
+    typedef Loki::Functor<int (int), CountingThreaded> Fun;
+    typedef Loki::Functor<int (int, int), CountingThreaded> Fun2;
+    typedef Loki::SharedFunctor<int (int), CountingThreaded> SharedFun;
+    typedef Loki::Delegate<int (int)> Delegate;
+    typedef std::function<int (int)> StdFunction;
+    typedef int (*FnPtr)(int);
+    typedef int (*FnPtr2)(int, int);
+
+    // Targets
+
+    unsigned long tallied;
+
+    int Next(int x)
+    {
+        return x * 3 + 1;
+    }
+
+    int Add(int x, int y)
+    {
+        return x * 3 + y;
+    }
+
+    int Tally(int x)
+    {
+        ++tallied;
+        return x;
+    }
+
+    struct Step
+    {
+        int k_;
+
+        int operator()(int x) const
+        {
+            return x * 3 + k_;
+        }
+    };
+
+    struct Bulky
+    {
+        long state_[8];
+
+        int operator()(int x) const
+        {
+            return x * 3 + static_cast<int>(state_[0]);
+        }
+    };
+
+    struct Counter
+    {
+        int step_;
+
+        int Next(int x)
+        {
+            return x * 3 + step_;
+        }
+    };
+
+    // An object and a member function, called directly or through the pointer
+    struct Method
+    {
+        Counter* pObj_;
+        int (Counter::*pMemFn_)(int);
+
+        int operator()(int x) const
+        {
+            return (pObj_->*pMemFn_)(x);
+        }
+    };
+
+    struct DirectNext
+    {
+        int operator()(int x) const
+        {
+            return Next(x);
+        }
+    };
+
+    struct DirectMethod
+    {
+        Counter* pObj_;
+
+        int operator()(int x) const
+        {
+            return pObj_->Next(x);
+        }
+    };
+
+    // Helpers
+
+    // Defeats dead code elimination
+    volatile int sink;
+
+    template <class T>
+    const T& Opaque(const T& obj)
+    {
+        const T* volatile p = &obj;
+        return *p;
+    }
+
+    // Makes the compiler assume that *p is read and written, so that building
+    //     an object and destroying it isn't optimized away
+    inline void Escape(const void* p)
+    {
+        asm volatile("" : : "g"(p) : "memory");
+    }
+
+    // Makes the compiler forget the value of x, so that a loop of inlined
+    //     calls can't be folded into a closed form
+    inline void Launder(int& x)
+    {
+        asm volatile("" : "+r"(x));
+    }
+
+    // Size of the function at 'address', from the symbol table of the
+    //     executable; 0 if it can't be found
+    std::size_t CodeSize(const void* address)
+    {
+        static std::vector<char> image;
+        static bool loaded = false;
+        if (!loaded)
+        {
+            loaded = true;
+            if (std::FILE* file = std::fopen("/proc/self/exe", "rb"))
+            {
+                std::fseek(file, 0, SEEK_END);
+                image.resize(std::ftell(file));
+                std::fseek(file, 0, SEEK_SET);
+                if (std::fread(&image[0], 1, image.size(), file)
+                    != image.size()) image.clear();
+                std::fclose(file);
+            }
+        }
+        Dl_info info;
+        if (image.size() < sizeof(ElfW(Ehdr)) || !dladdr(address, &info))
+        {
+            return 0;
+        }
+
+        const ElfW(Ehdr)& header =
+            *reinterpret_cast<const ElfW(Ehdr)*>(&image[0]);
+        // Position independent executables are loaded at dli_fbase
+        const ElfW(Addr) value = reinterpret_cast<ElfW(Addr)>(address) -
+            (header.e_type == ET_DYN
+                ? reinterpret_cast<ElfW(Addr)>(info.dli_fbase) : 0);
+        const ElfW(Shdr)* sections =
+            reinterpret_cast<const ElfW(Shdr)*>(&image[header.e_shoff]);
+        for (unsigned s = 0; s != header.e_shnum; ++s)
+        {
+            if (sections[s].sh_type != SHT_SYMTAB) continue;
+            const ElfW(Sym)* symbols = reinterpret_cast<const ElfW(Sym)*>(
+                &image[sections[s].sh_offset]);
+            const std::size_t n = sections[s].sh_size / sizeof(ElfW(Sym));
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                if (symbols[i].st_value == value && symbols[i].st_size)
+                {
+                    return symbols[i].st_size;
+                }
+            }
+        }
+        return 0;
+    }
+
+    // Kernels: each does one operation n times
+
+    template <class Callback>
+    void Call(const Callback& callback, std::size_t n)
+    {
+        const Callback& c = Opaque(callback);
+        int x = 0;
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            x = c(x);
+            Launder(x);
+        }
+        sink = x;
+    }
+
+    // Builds a Callback from a Source and destroys it; a copy if they match
+    template <class Callback, class Source>
+    void Construct(const Source& source, std::size_t n)
+    {
+        const Source& s = Opaque(source);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            Callback c(s);
+            Escape(&c);
+        }
+    }
+
+    void ConstructFunFromMethod(const Method& method, std::size_t n)
+    {
+        const Method& m = Opaque(method);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            Fun c(m.pObj_, m.pMemFn_);
+            Escape(&c);
+        }
+    }
+
+    void ConstructStdFunctionFromBind(const Method& method, std::size_t n)
+    {
+        const Method& m = Opaque(method);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            StdFunction c(std::bind(m.pMemFn_, m.pObj_,
+                std::placeholders::_1));
+            Escape(&c);
+        }
+    }
+
+    void LokiBindFirst(const Fun2& fun, std::size_t n)
+    {
+        const Fun2& f = Opaque(fun);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            Fun c(Loki::BindFirst(f, 1));
+            Escape(&c);
+        }
+    }
+
+    void StdBind(const FnPtr2& fun, std::size_t n)
+    {
+        const FnPtr2 f = Opaque(fun);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            auto c = std::bind(f, 1, std::placeholders::_1);
+            Escape(&c);
+        }
+    }
+
+    void StdFunctionOfBind(const FnPtr2& fun, std::size_t n)
+    {
+        const FnPtr2 f = Opaque(fun);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            StdFunction c(std::bind(f, 1, std::placeholders::_1));
+            Escape(&c);
+        }
+    }
+
+    void LokiChain(const std::pair<Fun, Fun>& funs, std::size_t n)
+    {
+        const std::pair<Fun, Fun>& f = Opaque(funs);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            Fun c(Loki::Chain(f.first, f.second));
+            Escape(&c);
+        }
+    }
+
+    // Runs the kernel once to warm up, then measures it
+    template <class Arg>
+    void Row(const char* op, const char* callback,
+        void (*kernel)(const Arg&, std::size_t), const Arg& arg,
+        std::size_t n)
+    {
+        // Keeps the compiler from inlining the kernel here
+        void (*volatile pKernel)(const Arg&, std::size_t) = kernel;
+        pKernel(arg, n / 10 + 1);
+
+        heapAllocations = smallObjectLocks = 0;
+        const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        pKernel(arg, n);
+        const double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / n;
+        // One lock to allocate and one to deallocate
+        const double heap = static_cast<double>(heapAllocations) / n;
+        const double small = static_cast<double>(smallObjectLocks) / 2 / n;
+
+        const std::size_t code =
+            CodeSize(reinterpret_cast<const void*>(kernel));
+        char codeText[16] = "-";
+        if (code) std::snprintf(codeText, sizeof(codeText), "%u",
+            static_cast<unsigned>(code));
+        std::printf("%-10s %-36s %8.2f %8.2f %8.2f %6s\n", op, callback, ns,
+            heap, small, codeText);
+    }
+
+    void Heading(const char* target)
+    {
+        std::printf("\n%s\n", target);
+    }
+}
+
+// Counts the allocations; the array forms call these
+
+void* operator new(std::size_t size)
+{
+    ++heapAllocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 2000000;
+
+    const FnPtr fnPtr = &Next;
+    const Step step = { 1 };
+    const Bulky bulky = { { 1 } };
+    Counter counter = { 1 };
+    const Method method = { &counter, &Counter::Next };
+    const auto bound = [](int x) { return Add(1, x); };
+    const auto chained = [](int x) { Tally(x); return Next(x); };
+
+    std::printf("%lu operations per row\n", static_cast<unsigned long>(n));
+    std::printf("%-10s %-36s %8s %8s %8s %6s\n", "operation", "callback",
+        "ns/op", "heap/op", "small/op", "code");
+
+    Heading("free function");
+    Row("call", "direct call", &Call<DirectNext>, DirectNext(), n);
+    Row("call", "pointer to function", &Call<FnPtr>, fnPtr, n);
+    Row("call", "Delegate, FromFunction", &Call<Delegate>,
+        Delegate::FromFunction<&Next>(), n);
+    Row("call", "Delegate, function pointer", &Call<Delegate>,
+        Delegate(fnPtr), n);
+    Row("call", "Functor", &Call<Fun>, Fun(fnPtr), n);
+    Row("call", "SharedFunctor", &Call<SharedFun>, SharedFun(fnPtr), n);
+    Row("call", "std::function", &Call<StdFunction>, StdFunction(fnPtr), n);
+    Row("construct", "Delegate", &Construct<Delegate, FnPtr>, fnPtr, n);
+    Row("construct", "Functor", &Construct<Fun, FnPtr>, fnPtr, n);
+    Row("construct", "SharedFunctor", &Construct<SharedFun, FnPtr>, fnPtr, n);
+    Row("construct", "std::function", &Construct<StdFunction, FnPtr>,
+        fnPtr, n);
+    Row("copy", "Delegate", &Construct<Delegate, Delegate>,
+        Delegate(fnPtr), n);
+    Row("copy", "Functor", &Construct<Fun, Fun>, Fun(fnPtr), n);
+    Row("copy", "SharedFunctor", &Construct<SharedFun, SharedFun>,
+        SharedFun(fnPtr), n);
+    Row("copy", "std::function", &Construct<StdFunction, StdFunction>,
+        StdFunction(fnPtr), n);
+
+    Heading("function object (4 bytes, or 64 bytes for 'bulky')");
+    Row("call", "direct call", &Call<Step>, step, n);
+    Row("call", "Delegate, FromObject", &Call<Delegate>,
+        Delegate::FromObject(step), n);
+    Row("call", "Functor", &Call<Fun>, Fun(step), n);
+    Row("call", "Functor, bulky", &Call<Fun>, Fun(bulky), n);
+    Row("call", "std::function", &Call<StdFunction>, StdFunction(step), n);
+    Row("call", "std::function, bulky", &Call<StdFunction>,
+        StdFunction(bulky), n);
+    Row("construct", "Functor", &Construct<Fun, Step>, step, n);
+    Row("construct", "Functor, bulky", &Construct<Fun, Bulky>, bulky, n);
+    Row("construct", "std::function", &Construct<StdFunction, Step>, step, n);
+    Row("construct", "std::function, bulky", &Construct<StdFunction, Bulky>,
+        bulky, n);
+    Row("copy", "Functor", &Construct<Fun, Fun>, Fun(step), n);
+    Row("copy", "Functor, bulky", &Construct<Fun, Fun>, Fun(bulky), n);
+    Row("copy", "std::function", &Construct<StdFunction, StdFunction>,
+        StdFunction(step), n);
+    Row("copy", "std::function, bulky", &Construct<StdFunction, StdFunction>,
+        StdFunction(bulky), n);
+
+    Heading("member function");
+    const DirectMethod directMethod = { &counter };
+    Row("call", "direct call", &Call<DirectMethod>, directMethod, n);
+    Row("call", "pointer to member function", &Call<Method>, method, n);
+    Row("call", "Delegate, FromMethod", &Call<Delegate>,
+        Delegate::FromMethod<Counter, &Counter::Next>(&counter), n);
+    Row("call", "Functor", &Call<Fun>, Fun(&counter, &Counter::Next), n);
+    Row("call", "std::function of std::bind", &Call<StdFunction>,
+        StdFunction(std::bind(&Counter::Next, &counter,
+            std::placeholders::_1)), n);
+    Row("call", "std::function of a lambda", &Call<StdFunction>,
+        StdFunction([&counter](int x) { return counter.Next(x); }), n);
+    Row("construct", "Functor", &ConstructFunFromMethod, method, n);
+    Row("construct", "std::function of std::bind",
+        &ConstructStdFunctionFromBind, method, n);
+    Row("copy", "Functor", &Construct<Fun, Fun>,
+        Fun(&counter, &Counter::Next), n);
+
+    Heading("bound first argument");
+    const FnPtr2 add = &Add;
+    const Fun2 fun2(add);
+    const Fun boundFun(Loki::BindFirst(fun2, 1));
+    const auto stdBound = std::bind(add, 1, std::placeholders::_1);
+    Row("call", "lambda", &Call<decltype(bound)>, bound, n);
+    Row("call", "BindFirst", &Call<Fun>, boundFun, n);
+    Row("call", "std::bind", &Call<decltype(stdBound)>, stdBound, n);
+    Row("call", "std::function of std::bind", &Call<StdFunction>,
+        StdFunction(stdBound), n);
+    Row("bind", "BindFirst", &LokiBindFirst, fun2, n);
+    Row("bind", "std::bind", &StdBind, add, n);
+    Row("bind", "std::function of std::bind", &StdFunctionOfBind, add, n);
+    Row("copy", "BindFirst", &Construct<Fun, Fun>, boundFun, n);
+    Row("copy", "std::function of std::bind",
+        &Construct<StdFunction, StdFunction>, StdFunction(stdBound), n);
+
+    Heading("chained");
+    const std::pair<Fun, Fun> funs = std::make_pair(Fun(&Tally), Fun(fnPtr));
+    const Fun chainedFun(Loki::Chain(funs.first, funs.second));
+    Row("call", "lambda", &Call<decltype(chained)>, chained, n);
+    Row("call", "Chain", &Call<Fun>, chainedFun, n);
+    Row("call", "std::function of a lambda", &Call<StdFunction>,
+        StdFunction(chained), n);
+    Row("chain", "Chain", &LokiChain, funs, n);
+    Row("construct", "std::function of a lambda",
+        &Construct<StdFunction, decltype(chained)>, chained, n);
+    Row("copy", "Chain", &Construct<Fun, Fun>, chainedFun, n);
+    Row("copy", "std::function of a lambda",
+        &Construct<StdFunction, StdFunction>, StdFunction(chained), n);
+    return 0;
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// Cost of a call through a Delegate, compared with a direct call, a lambda
+//     called through a template (both of which the compiler inlines), a raw
+//     pointer to function or to member function, std::function and Functor
+// Each callback is reached through a volatile pointer, so that the compiler
+//     can't see what it holds and has to make the indirect call
+// Also checks that an empty Delegate converts to an empty Functor
+// Build: g++ -O2 -pthread DelegateBench.cpp ../4.SmallObj/SmallObj.cpp
+//     ../4.SmallObj/Singleton.cpp ../4.SmallObj/HeapProfiler.cpp
+// Usage: ./a.out [calls]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Functor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+namespace
+{
+    int Next(int x)
+    {
+        return x * 3 + 1;
+    }
+
+    struct Counter
+    {
+        int step_;
+
+        int Next(int x)
+        {
+            return x * 3 + step_;
+        }
+    };
+
+    typedef Loki::Delegate<int (int)> Delegate;
+    typedef Loki::Functor<int (int)> LokiFunctor;
+    typedef std::function<int (int)> StdFunction;
+
+    // Defeats dead code elimination
+    volatile int sink;
+
+    typedef std::chrono::steady_clock Clock;
+
+    template <class Callback>
+    const Callback& Opaque(const Callback& callback)
+    {
+        const Callback* volatile p = &callback;
+        return *p;
+    }
+
+    // Each call depends on the result of the previous one
+    template <class Callback>
+    double NsPerCall(const Callback& callback, std::size_t n)
+    {
+        const Callback& c = Opaque(callback);
+        int x = 0;
+        const Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i != n; ++i) x = c(x);
+        const double ns = std::chrono::duration<double, std::nano>(
+            Clock::now() - start).count() / n;
+        sink = x;
+        return ns;
+    }
+
+    template <class Callback>
+    void Row(const char* name, const Callback& callback, std::size_t n)
+    {
+        NsPerCall(callback, n);
+        std::printf("%-36s %9.2f %6u\n", name, NsPerCall(callback, n),
+            static_cast<unsigned>(sizeof(Callback)));
+    }
+
+    // Calls a pointer to member function
+    struct MemFnCall
+    {
+        Counter* pObj_;
+        int (Counter::*pMemFn_)(int);
+
+        int operator()(int x) const
+        {
+            return (pObj_->*pMemFn_)(x);
+        }
+    };
+
+    // Calls a pointer to function
+    struct FnCall
+    {
+        int (*pFn_)(int);
+
+        int operator()(int x) const
+        {
+            return pFn_(x);
+        }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 100000000;
+    Counter counter = { 1 };
+    const auto lambda = [](int x) { return x * 3 + 1; };
+
+    std::printf("ns per call, %lu calls\n", static_cast<unsigned long>(n));
+    std::printf("%-36s %9s %6s\n", "callback", "call", "size");
+
+    Row("direct call", [](int x) { return Next(x); }, n);
+    Row("lambda, through a template", lambda, n);
+    const FnCall fnCall = { &Next };
+    Row("pointer to function", fnCall, n);
+    const MemFnCall memFnCall = { &counter, &Counter::Next };
+    Row("pointer to member function", memFnCall, n);
+
+    Row("Delegate, FromFunction", Delegate::FromFunction<&Next>(), n);
+    Row("Delegate, function pointer", Delegate(&Next), n);
+    Row("Delegate, FromMethod",
+        Delegate::FromMethod<Counter, &Counter::Next>(&counter), n);
+    Row("Delegate, FromObject(lambda)", Delegate::FromObject(lambda), n);
+
+    Row("std::function, function pointer", StdFunction(&Next), n);
+    Row("std::function, member function",
+        StdFunction(std::bind(&Counter::Next, &counter,
+            std::placeholders::_1)), n);
+    Row("std::function, lambda", StdFunction(lambda), n);
+
+    Row("Functor, function pointer", LokiFunctor(&Next), n);
+    Row("Functor, member function",
+        LokiFunctor(&counter, &Counter::Next), n);
+    Row("Functor, lambda", LokiFunctor(lambda), n);
+    Row("Functor holding a Delegate",
+        LokiFunctor(Delegate::FromFunction<&Next>()), n);
+
+    // Empty Delegates must give empty Functors, which callers test before
+    //     calling them
+    int (*pNull)(int) = 0;
+    if (Delegate(pNull) || LokiFunctor(Delegate()) ||
+        LokiFunctor(Delegate(pNull)) || !LokiFunctor(Delegate(&Next)))
+    {
+        std::printf("an empty Delegate converted to a non-empty Functor\n");
+        return 1;
+    }
+    return 0;
+}
@@ -1,23 +1,45 @@
-
 #ifndef FUNCTOR_INC_
 #define FUNCTOR_INC_
 
-#include "../2&3.Techniques/Typelist.h"
 #include "../4.SmallObj/SmallObj.h"
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <typeinfo>
 #include <memory>
+#include <utility>
+
+// Size of the buffer in which Functor stores small callables (function
+//     pointers, member function bindings, lambdas with a few captures)
+//     instead of allocating them
+#ifndef FUNCTOR_SMALL_BUFFER_SIZE
+#define FUNCTOR_SMALL_BUFFER_SIZE (4 * sizeof(void*))
+#endif
 
-namespace Private
+namespace Loki
+{
+    namespace Private
     {
-        template <typename R, template <class> class ThreadingModel>
+        template <template <class> class ThreadingModel>
         struct FunctorImplBase : public SmallObject<ThreadingModel>
         {
-            typedef R ResultType;
-            
-            typedef EmptyType Parm1;
-            typedef EmptyType Parm2;
-
             virtual FunctorImplBase* DoClone() const = 0;
+            // Copy constructs the object in 'buffer'; only needed by the
+            //     handlers that Functor stores inline
+            virtual FunctorImplBase* DoCloneInto(void* buffer) const
+            {
+                (void)buffer;
+                assert(false);
+                return 0;
+            }
+            // Move constructs the object in 'buffer', without throwing
+            virtual FunctorImplBase* DoMoveInto(void* buffer)
+            {
+                (void)buffer;
+                assert(false);
+                return 0;
+            }
             template <class U>
             static U* Clone(U* pObj)
             {
@@ -26,15 +48,60 @@ namespace Private
                 assert(typeid(*pClone) == typeid(*pObj));
                 return pClone;
             }
+            template <class U>
+            static U* CloneInto(const U* pObj, void* buffer)
+            {
+                U* pClone = static_cast<U*>(pObj->DoCloneInto(buffer));
+                assert(typeid(*pClone) == typeid(*pObj));
+                return pClone;
+            }
+            template <class U>
+            static U* MoveInto(U* pObj, void* buffer)
+            {
+                return static_cast<U*>(pObj->DoMoveInto(buffer));
+            }
+        };
+
+        // Whether Functor can store a handler in its buffer; it must move
+        //     without throwing, so that moving a Functor can't throw
+        template <class Handler>
+        struct FitsFunctorBuffer : std::integral_constant<bool,
+            sizeof(Handler) <= FUNCTOR_SMALL_BUFFER_SIZE &&
+            alignof(Handler) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<Handler>::value>
+        {};
+
+        // Whether a callable given to a Functor or a SharedFunctor is empty,
+        //     which makes the result empty rather than a call to nothing;
+        //     specialized for the empty-able callables of this file
+        template <class Fun>
+        struct EmptyCallable
+        {
+            static bool Test(const Fun&)
+            { return false; }
+        };
+
+        template <typename R, typename... Args>
+        struct EmptyCallable<R (*)(Args...)>
+        {
+            static bool Test(R (*pFn)(Args...))
+            { return !pFn; }
         };
     }
 
 
 
 // macro DEFINE_CLONE_FUNCTORIMPL
-// Implements the DoClone function for a functor implementation
+// Implements the DoClone, DoCloneInto and DoMoveInto functions for a functor
+//     implementation
+// The last two use the global placement new, which SmallObject's operator new
+//     would otherwise hide
 #define DEFINE_CLONE_FUNCTORIMPL(Cls) \
-    virtual Cls* DoClone() const { return new Cls(*this); }
+    virtual Cls* DoClone() const { return new Cls(*this); } \
+    virtual Cls* DoCloneInto(void* buffer) const \
+    { return ::new(buffer) Cls(*this); } \
+    virtual Cls* DoMoveInto(void* buffer) \
+    { return ::new(buffer) Cls(std::move(*this)); }
 
 
 
@@ -43,302 +110,606 @@ namespace Private
 //     directly; rather, the Functor class manages and forwards to a pointer to
 //     FunctorImpl
 // You may want to derive your own functors from FunctorImpl.
-// Specializations of FunctorImpl for up to 15 parameters follow
+// Takes a function type, as in FunctorImpl<void (int, const Event&)>, of any
+//     arity. The arguments arrive as Args&&...: references are passed as
+//     they are, and parameters taken by value are moved in by Functor
+
+    template <typename Signature,
+        template <class> class ThreadingModel = DEFAULT_THREADING>
+    class FunctorImpl;
+
+    template <typename R, typename... Args,
+        template <class> class ThreadingModel>
+    class FunctorImpl<R (Args...), ThreadingModel>
+        : public Private::FunctorImplBase<ThreadingModel>
+    {
+    public:
+        typedef R ResultType;
+        virtual R operator()(Args&&... args) = 0;
+    };
 
-template <typename R, class TList, 
-    template <class> class ThreadingModel = DEFAULT_THREADING>
-class FunctorImpl;
 
+// class template FunctorHandler
+// Wraps functors and pointers to functions
 
-// class template FunctorImpl
+    template <class ParentFunctor, typename Fun,
+        typename Signature = typename ParentFunctor::Signature>
+    class FunctorHandler;
 
-template <typename R, template <class> class ThreadingModel>
-class FunctorImpl<R, NullType, ThreadingModel>
-    : public Private::FunctorImplBase<R, ThreadingModel>
-{
-public:
-    typedef R ResultType;
-    virtual R operator()() = 0;
-};
-
-template <typename R, typename P1, template <class> class ThreadingModel>
-class FunctorImpl<R, TYPELIST_1(P1), ThreadingModel>
-    : public Private::FunctorImplBase<R, ThreadingModel>
-{
-public:
-    typedef R ResultType;
-    typedef typename TypeTraits<P1>::ParameterType Parm1;
-    virtual R operator()(Parm1) = 0;
-};
-
-template <typename R, typename P1, typename P2, 
-    template <class> class ThreadingModel>
-class FunctorImpl<R, TYPELIST_2(P1, P2), ThreadingModel>
-    : public Private::FunctorImplBase<R, ThreadingModel>
-{
-public:
-    typedef R ResultType;
-    typedef typename TypeTraits<P1>::ParameterType Parm1;
-    typedef typename TypeTraits<P2>::ParameterType Parm2;
-    virtual R operator()(Parm1, Parm2) = 0;
-};
+    template <class ParentFunctor, typename Fun,
+        typename R, typename... Args>
+    class FunctorHandler<ParentFunctor, Fun, R (Args...)>
+        : public ParentFunctor::Impl
+    {
+        typedef typename ParentFunctor::Impl Base;
 
+    public:
+        typedef typename Base::ResultType ResultType;
 
-// class template FunctorHandler
-// Wraps functors and pointers to functions
+        FunctorHandler(const Fun& fun) : f_(fun) {}
+        FunctorHandler(Fun&& fun) : f_(std::move(fun)) {}
 
-template <class ParentFunctor, typename Fun>
-class FunctorHandler
-    : public ParentFunctor::Impl
-{
-    typedef typename ParentFunctor::Impl Base;
-
-public:
-    typedef typename Base::ResultType ResultType;
-    typedef typename Base::Parm1 Parm1;
-    typedef typename Base::Parm2 Parm2;
-    
-    FunctorHandler(const Fun& fun) : f_(fun) {}
-    
-    DEFINE_CLONE_FUNCTORIMPL(FunctorHandler)
-
-    // operator() implementations for up to 15 arguments
-            
-    ResultType operator()()
-    { return f_(); }
-
-    ResultType operator()(Parm1 p1)
-    { return f_(p1); }
-    
-    ResultType operator()(Parm1 p1, Parm2 p2)
-    { return f_(p1, p2); }
-    
-private:
-    Fun f_;
-};
+        DEFINE_CLONE_FUNCTORIMPL(FunctorHandler)
 
+        ResultType operator()(Args&&... args)
+        { return f_(std::forward<Args>(args)...); }
 
-// class template FunctorHandler
+    private:
+        Fun f_;
+    };
+
+
+// class template MemFunHandler
 // Wraps pointers to member functions
 
-template <class ParentFunctor, typename PointerToObj,
-    typename PointerToMemFn>
-class MemFunHandler : public ParentFunctor::Impl
-{
-    typedef typename ParentFunctor::Impl Base;
-
-public:
-    typedef typename Base::ResultType ResultType;
-    typedef typename Base::Parm1 Parm1;
-    typedef typename Base::Parm2 Parm2;
-    
-    MemFunHandler(const PointerToObj& pObj, PointerToMemFn pMemFn) 
-    : pObj_(pObj), pMemFn_(pMemFn)
-    {}
-    
-    DEFINE_CLONE_FUNCTORIMPL(MemFunHandler)
-    
-    ResultType operator()()
-    { return ((*pObj_).*pMemFn_)(); }
-
-    ResultType operator()(Parm1 p1)
-    { return ((*pObj_).*pMemFn_)(p1); }
-    
-    ResultType operator()(Parm1 p1, Parm2 p2)
-    { return ((*pObj_).*pMemFn_)(p1, p2); }
-    
-private:
-    PointerToObj pObj_;
-    PointerToMemFn pMemFn_;
-};
-    
+    template <class ParentFunctor, typename PointerToObj,
+        typename PointerToMemFn,
+        typename Signature = typename ParentFunctor::Signature>
+    class MemFunHandler;
+
+    template <class ParentFunctor, typename PointerToObj,
+        typename PointerToMemFn, typename R, typename... Args>
+    class MemFunHandler<ParentFunctor, PointerToObj, PointerToMemFn,
+        R (Args...)> : public ParentFunctor::Impl
+    {
+        typedef typename ParentFunctor::Impl Base;
+
+    public:
+        typedef typename Base::ResultType ResultType;
+
+        MemFunHandler(const PointerToObj& pObj, PointerToMemFn pMemFn)
+        : pObj_(pObj), pMemFn_(pMemFn)
+        {}
+
+        DEFINE_CLONE_FUNCTORIMPL(MemFunHandler)
+
+        ResultType operator()(Args&&... args)
+        { return ((*pObj_).*pMemFn_)(std::forward<Args>(args)...); }
+
+    private:
+        PointerToObj pObj_;
+        PointerToMemFn pMemFn_;
+    };
+
 
 // class template Functor
 // A generalized functor implementation with value semantics
+// Takes a function type, as in Functor<void (int, const Event&)>, of any arity.
+//     operator() takes the arguments as declared and forwards them to the
+//     callable: references are never copied, and a parameter taken by value
+//     is moved down, so move-only types work
+// Callables whose handler fits in FUNCTOR_SMALL_BUFFER_SIZE bytes are stored
+//     in the Functor itself: creating, copying and destroying those doesn't
+//     touch the allocator. Larger ones live on the heap, as do the
+//     implementations passed in a unique_ptr
+// Moving never allocates nor throws: it moves an inline callable, and steals
+//     the pointer to a heap one
+// An empty source (a null pointer to function, an empty SharedFunctor or
+//     Delegate) gives an empty Functor
+
+    template <typename Signature,
+        template <class> class ThreadingModel = DEFAULT_THREADING>
+    class Functor;
+
+    template <typename R, typename... Args,
+        template <class> class ThreadingModel>
+    class Functor<R (Args...), ThreadingModel>
+    {
+    public:
+        // Handy type definitions for the body type
+        typedef FunctorImpl<R (Args...), ThreadingModel> Impl;
+        typedef R ResultType;
+        typedef R Signature(Args...);
 
-template <typename R, class TList = NullType,
-    template<class> class ThreadingModel = DEFAULT_THREADING>
-class Functor
-{
-public:
-    // Handy type definitions for the body type
-    typedef FunctorImpl<R, TList, ThreadingModel> Impl;
-    typedef R ResultType;
-    typedef TList ParmList;
-    typedef typename Impl::Parm1 Parm1;
-    typedef typename Impl::Parm2 Parm2;
-
-    // Member functions
-
-    Functor() : spImpl_(0)
-    {}
-    
-    Functor(const Functor& rhs) : spImpl_(Impl::Clone(rhs.spImpl_.get()))
-    {}
-    
-    Functor(std::auto_ptr<Impl> spImpl) : spImpl_(spImpl)
-    {}
-    
-    template <typename Fun>
-    Functor(Fun fun)
-    : spImpl_(new FunctorHandler<Functor, Fun>(fun))
-    {}
-
-    template <class PtrObj, typename MemFn>
-    Functor(const PtrObj& p, MemFn memFn)
-    : spImpl_(new MemFunHandler<Functor, PtrObj, MemFn>(p, memFn))
-    {}
-
-    typedef Impl * (std::auto_ptr<Impl>::*unspecified_bool_type)() const;
-
-    operator unspecified_bool_type() const
+        // Member functions
+
+        Functor() : pImpl_(0)
+        {}
+
+        Functor(const Functor& rhs) : pImpl_(rhs.CloneImpl(buffer_))
+        {}
+
+        Functor(Functor&& rhs) noexcept : pImpl_(0)
+        { Steal(rhs); }
+
+        explicit Functor(std::unique_ptr<Impl> spImpl)
+        : pImpl_(spImpl.release())
+        {}
+
+        template <typename Fun>
+        Functor(Fun fun)
+        : pImpl_(Private::EmptyCallable<Fun>::Test(fun) ? 0 :
+            Create<FunctorHandler<Functor, Fun> >(
+                Private::FitsFunctorBuffer<FunctorHandler<Functor, Fun> >(),
+                std::move(fun)))
+        {}
+
+        template <class PtrObj, typename MemFn>
+        Functor(const PtrObj& p, MemFn memFn)
+        : pImpl_(Create<MemFunHandler<Functor, PtrObj, MemFn> >(
+            Private::FitsFunctorBuffer<
+                MemFunHandler<Functor, PtrObj, MemFn> >(),
+            p, memFn))
+        {}
+
+        ~Functor()
+        { DestroyImpl(); }
+
+        typedef Impl* Functor::*unspecified_bool_type;
+
+        operator unspecified_bool_type() const
+        {
+            return pImpl_ ? &Functor::pImpl_ : 0;
+        }
+
+        Functor& operator=(const Functor& rhs)
+        {
+            Functor copy(rhs);
+            return *this = std::move(copy);
+        }
+
+        Functor& operator=(Functor&& rhs) noexcept
+        {
+            if (this == &rhs) return *this;
+            DestroyImpl();
+            pImpl_ = 0;
+            Steal(rhs);
+            return *this;
+        }
+
+        ResultType operator()(Args... args) const
+        { return (*pImpl_)(std::forward<Args>(args)...); }
+
+    private:
+        // Constructs a handler inline (std::true_type) or on the heap
+        template <class Handler, typename... Ts>
+        Impl* Create(std::true_type, Ts&&... ts)
+        { return ::new(buffer_) Handler(std::forward<Ts>(ts)...); }
+
+        template <class Handler, typename... Ts>
+        Impl* Create(std::false_type, Ts&&... ts)
+        { return new Handler(std::forward<Ts>(ts)...); }
+
+        bool IsInline() const
+        { return static_cast<const void*>(pImpl_) == buffer_; }
+
+        // Copies the implementation, into 'buffer' if it is stored inline
+        Impl* CloneImpl(void* buffer) const
+        {
+            if (!pImpl_) return 0;
+            if (IsInline()) return Impl::CloneInto(pImpl_, buffer);
+            return Impl::Clone(pImpl_);
+        }
+
+        void DestroyImpl()
+        {
+            if (IsInline()) pImpl_->~Impl();
+            else delete pImpl_;
+        }
+
+        // Takes rhs's implementation, leaving rhs empty; *this must be empty
+        void Steal(Functor& rhs)
+        {
+            if (!rhs.IsInline())
+            {
+                pImpl_ = rhs.pImpl_;
+            }
+            else
+            {
+                pImpl_ = Impl::MoveInto(rhs.pImpl_, buffer_);
+                rhs.pImpl_->~Impl();
+            }
+            rhs.pImpl_ = 0;
+        }
+
+        // Points into buffer_ or to the heap
+        Impl* pImpl_;
+        alignas(std::max_align_t)
+            unsigned char buffer_[FUNCTOR_SMALL_BUFFER_SIZE];
+    };
+
+
+// class template SharedFunctor
+// A Functor whose copies share one immutable implementation, reference
+//     counted as per the ThreadingModel: a copy costs a pointer copy and a
+//     counter increment, whatever the size of the callable
+// The shared callable is called through all the copies, so it should be
+//     stateless, or safe to call from the threads that hold the copies
+// Converts to a Functor (which stores the SharedFunctor inline)
+
+    template <typename Signature,
+        template <class> class ThreadingModel = DEFAULT_THREADING>
+    class SharedFunctor;
+
+    template <typename R, typename... Args,
+        template <class> class ThreadingModel>
+    class SharedFunctor<R (Args...), ThreadingModel>
     {
-        return spImpl_.get() ? &std::auto_ptr<Impl>::get : 0;
-    }
+        struct Body;
+        template <class Fun> struct BodyOf;
+
+    public:
+        // Handy type definitions for the body type
+        typedef Functor<R (Args...), ThreadingModel> FunctorType;
+        typedef typename FunctorType::Impl Impl;
+        typedef R ResultType;
+        typedef R Signature(Args...);
+
+        // Member functions
+
+        SharedFunctor() : pBody_(0)
+        {}
+
+        SharedFunctor(const SharedFunctor& rhs) : pBody_(rhs.pBody_)
+        {
+            if (pBody_) Body::AtomicIncrement(pBody_->count_);
+        }
+
+        SharedFunctor(SharedFunctor&& rhs) noexcept : pBody_(rhs.pBody_)
+        {
+            rhs.pBody_ = 0;
+        }
+
+        SharedFunctor(const FunctorType& fun)
+        : pBody_(fun ? new BodyOf<FunctorType>(fun) : 0)
+        {}
+
+        SharedFunctor(FunctorType&& fun)
+        : pBody_(fun ? new BodyOf<FunctorType>(std::move(fun)) : 0)
+        {}
 
-    Functor& operator=(const Functor& rhs)
+        template <typename Fun>
+        SharedFunctor(Fun fun)
+        : pBody_(Private::EmptyCallable<Fun>::Test(fun) ? 0 :
+            new BodyOf<Fun>(std::move(fun)))
+        {}
+
+        template <class PtrObj, typename MemFn>
+        SharedFunctor(const PtrObj& p, MemFn memFn)
+        : pBody_(new BodyOf<FunctorType>(FunctorType(p, memFn)))
+        {}
+
+        ~SharedFunctor()
+        {
+            if (pBody_ && Body::AtomicDecrement(pBody_->count_) == 0)
+            {
+                delete pBody_;
+            }
+        }
+
+        typedef Body* SharedFunctor::*unspecified_bool_type;
+
+        operator unspecified_bool_type() const
+        {
+            return pBody_ ? &SharedFunctor::pBody_ : 0;
+        }
+
+        SharedFunctor& operator=(SharedFunctor rhs)
+        {
+            std::swap(pBody_, rhs.pBody_);
+            return *this;
+        }
+
+        ResultType operator()(Args... args) const
+        { return (*pBody_)(std::forward<Args>(args)...); }
+
+    private:
+        // The callable is stored in the Body itself rather than in a Functor,
+        //     so that the Body of a callable that fits a Functor's buffer is
+        //     still a small object
+        struct Body : public SmallObject<ThreadingModel>
+        {
+            Body() : count_(1)
+            {}
+
+            virtual ~Body()
+            {}
+
+            virtual R operator()(Args&&... args) = 0;
+
+            volatile typename Body::IntType count_;
+        };
+
+        template <class Fun>
+        struct BodyOf : public Body
+        {
+            template <class F>
+            explicit BodyOf(F&& fun) : fun_(std::forward<F>(fun))
+            {}
+
+            R operator()(Args&&... args)
+            { return fun_(std::forward<Args>(args)...); }
+
+            Fun fun_;
+        };
+
+        Body* pBody_;
+    };
+
+    namespace Private
     {
-        Functor copy(rhs);
-        // swap auto_ptrs by hand
-        Impl* p = spImpl_.release();
-        spImpl_.reset(copy.spImpl_.release());
-        copy.spImpl_.reset(p);
-        return *this;
+        template <typename Signature, template <class> class ThreadingModel>
+        struct EmptyCallable< SharedFunctor<Signature, ThreadingModel> >
+        {
+            static bool Test(const SharedFunctor<Signature, ThreadingModel>& f)
+            { return !f; }
+        };
     }
-    
-    ResultType operator()() const
-    { return (*spImpl_)(); }
 
-    ResultType operator()(Parm1 p1) const
-    { return (*spImpl_)(p1); }
-    
-    ResultType operator()(Parm1 p1, Parm2 p2) const
-    { return (*spImpl_)(p1, p2); }
 
-private:
-    std::auto_ptr<Impl> spImpl_;
-};
+// class template Delegate
+// A callback that holds a pointer to its target and a pointer to a stub that
+//     calls it: calling a Delegate is one indirect call, with no virtual
+//     function, and creating or copying one never allocates
+// The target isn't owned and must outlive the Delegate. It is one of
+//         Delegate<int (int)>::FromFunction<&Twice>()
+//         Delegate<int (int)>::FromMethod<Counter, &Counter::Add>(&counter)
+//         Delegate<int (int)>::FromObject(lambda)
+//     or a function pointer known only at run time, passed to the constructor
+// The functions known at compile time are called directly by their stub,
+//     which is where the compiler inlines them
+// Converts to a Functor of the same signature, which stores it inline (empty
+//     if the Delegate is); a Functor is called through a Delegate with
+//     FromObject
+
+    template <typename Signature>
+    class Delegate;
+
+    template <typename R, typename... Args>
+    class Delegate<R (Args...)>
+    {
+        union Target
+        {
+            void* pObj_;
+            R (*pFn_)(Args...);
+        };
+
+        typedef R (*Stub)(Target, Args&&...);
 
+    public:
+        typedef R ResultType;
+        typedef R Signature(Args...);
 
-namespace Private
-{
-    template <class Fctor> struct BinderFirstTraits;
+        // Member functions
+
+        Delegate() : stub_(0)
+        { target_.pObj_ = 0; }
+
+        Delegate(R (*pFn)(Args...)) : stub_(pFn ? &CallFunction : 0)
+        { target_.pFn_ = pFn; }
+
+        template <R (*Fn)(Args...)>
+        static Delegate FromFunction()
+        {
+            Target target;
+            target.pObj_ = 0;
+            return Delegate(&CallStaticFunction<Fn>, target);
+        }
+
+        template <class T, R (T::*MemFn)(Args...)>
+        static Delegate FromMethod(T* pObj)
+        {
+            Target target;
+            target.pObj_ = pObj;
+            return Delegate(&CallMethod<T, MemFn>, target);
+        }
+
+        template <class T, R (T::*MemFn)(Args...) const>
+        static Delegate FromMethod(const T* pObj)
+        {
+            Target target;
+            target.pObj_ = const_cast<T*>(pObj);
+            return Delegate(&CallConstMethod<T, MemFn>, target);
+        }
+
+        // Fun may be const, in which case its operator() must be const
+        template <class Fun>
+        static Delegate FromObject(Fun& fun)
+        {
+            typedef typename std::remove_const<Fun>::type Object;
+            Target target;
+            target.pObj_ = const_cast<Object*>(&fun);
+            return Delegate(&CallObject<Fun>, target);
+        }
+
+        // A temporary would be gone by the time the Delegate is called
+        template <class Fun>
+        static Delegate FromObject(const Fun&&) = delete;
+
+        typedef Stub Delegate::*unspecified_bool_type;
 
-    template <typename R, class TList, template <class> class ThreadingModel>
-    struct BinderFirstTraits< Functor<R, TList, ThreadingModel> >
+        operator unspecified_bool_type() const
+        {
+            return stub_ ? &Delegate::stub_ : 0;
+        }
+
+        ResultType operator()(Args... args) const
+        { return stub_(target_, std::forward<Args>(args)...); }
+
+    private:
+        Delegate(Stub stub, Target target) : target_(target), stub_(stub)
+        {}
+
+        static R CallFunction(Target target, Args&&... args)
+        { return target.pFn_(std::forward<Args>(args)...); }
+
+        template <R (*Fn)(Args...)>
+        static R CallStaticFunction(Target, Args&&... args)
+        { return Fn(std::forward<Args>(args)...); }
+
+        template <class T, R (T::*MemFn)(Args...)>
+        static R CallMethod(Target target, Args&&... args)
+        {
+            return (static_cast<T*>(target.pObj_)->*MemFn)(
+                std::forward<Args>(args)...);
+        }
+
+        template <class T, R (T::*MemFn)(Args...) const>
+        static R CallConstMethod(Target target, Args&&... args)
+        {
+            return (static_cast<const T*>(target.pObj_)->*MemFn)(
+                std::forward<Args>(args)...);
+        }
+
+        template <class Fun>
+        static R CallObject(Target target, Args&&... args)
+        {
+            return (*static_cast<Fun*>(target.pObj_))(
+                std::forward<Args>(args)...);
+        }
+
+        Target target_;
+        Stub stub_;
+    };
+
+    namespace Private
+    {
+        template <typename Signature>
+        struct EmptyCallable< Delegate<Signature> >
+        {
+            static bool Test(const Delegate<Signature>& d)
+            { return !d; }
+        };
+    }
+
+
+    namespace Private
     {
-        typedef typename TL::Erase<TList, 
-                typename TL::TypeAt<TList, 0>::Result>::Result
-            ParmList;
-        typedef Functor<R, ParmList, ThreadingModel> BoundFunctorType;
-        typedef typename BoundFunctorType::Impl Impl;
-    };        
-}
+        template <class Fctor> struct BinderFirstTraits;
+
+        template <typename R, typename Bound, typename... Args,
+            template <class> class ThreadingModel>
+        struct BinderFirstTraits< Functor<R (Bound, Args...), ThreadingModel> >
+        {
+            typedef Functor<R (Args...), ThreadingModel> BoundFunctorType;
+            typedef typename BoundFunctorType::Impl Impl;
+            // A non-const lvalue reference parameter binds the object itself,
+            //     which must outlive the Functor; any other is bound to a copy
+            //     of the value, so that binding a const reference parameter
+            //     to a temporary doesn't dangle
+            typedef typename std::conditional<
+                std::is_lvalue_reference<Bound>::value &&
+                !std::is_const<
+                    typename std::remove_reference<Bound>::type>::value,
+                Bound, typename std::decay<Bound>::type>::type BoundType;
+        };
+    }
 
 
 // class template BinderFirst
 // Binds the first parameter of a Functor object to a specific value
 
-template <class OriginalFunctor>
-class BinderFirst 
-    : public Private::BinderFirstTraits<OriginalFunctor>::Impl
-{
-    typedef typename Private::BinderFirstTraits<OriginalFunctor>::Impl Base;
-    typedef typename OriginalFunctor::ResultType ResultType;
-
-    typedef typename OriginalFunctor::Parm1 BoundType;
-
-    typedef typename OriginalFunctor::Parm2 Parm1;
-    typedef typename OriginalFunctor::Parm3 Parm2;
-
-public:
-    BinderFirst(const OriginalFunctor& fun, BoundType bound)
-    : f_(fun), b_(bound)
-    {}
-    
-    DEFINE_CLONE_FUNCTORIMPL(BinderFirst)
-    
-    // operator() implementations for up to 15 arguments
-            
-    ResultType operator()()
-    { return f_(b_); }
-
-    ResultType operator()(Parm1 p1)
-    { return f_(b_, p1); }
-    
-    ResultType operator()(Parm1 p1, Parm2 p2)
-    { return f_(b_, p1, p2); }
-    
-private:
-    OriginalFunctor f_;
-    BoundType b_;
-};
+    template <class OriginalFunctor,
+        typename Signature = typename Private::BinderFirstTraits<
+            OriginalFunctor>::BoundFunctorType::Signature>
+    class BinderFirst;
+
+    template <class OriginalFunctor, typename R, typename... Args>
+    class BinderFirst<OriginalFunctor, R (Args...)>
+        : public Private::BinderFirstTraits<OriginalFunctor>::Impl
+    {
+        typedef typename OriginalFunctor::ResultType ResultType;
+
+        typedef typename Private::BinderFirstTraits<OriginalFunctor>::BoundType
+            BoundType;
+
+    public:
+        BinderFirst(const OriginalFunctor& fun, BoundType bound)
+        : f_(fun), b_(std::forward<BoundType>(bound))
+        {}
+
+        DEFINE_CLONE_FUNCTORIMPL(BinderFirst)
+
+        ResultType operator()(Args&&... args)
+        { return f_(b_, std::forward<Args>(args)...); }
+
+    private:
+        OriginalFunctor f_;
+        BoundType b_;
+    };
 
 
 // function template BindFirst
 // Binds the first parameter of a Functor object to a specific value
 
+    template <class Fctor>
+    typename Private::BinderFirstTraits<Fctor>::BoundFunctorType
+    BindFirst(
+        const Fctor& fun,
+        typename Private::BinderFirstTraits<Fctor>::BoundType bound)
+    {
+        typedef typename Private::BinderFirstTraits<Fctor>::BoundFunctorType
+            Outgoing;
 
-template <class Fctor>
-typename Private::BinderFirstTraits<Fctor>::BoundFunctorType
-BindFirst(
-    const Fctor& fun,
-    typename Fctor::Parm1 bound)
-{
-    typedef typename Private::BinderFirstTraits<Fctor>::BoundFunctorType
-        Outgoing;
-    
-    return Outgoing(std::auto_ptr<typename Outgoing::Impl>(
-        new BinderFirst<Fctor>(fun, bound)));
-}
+        return Outgoing(std::unique_ptr<typename Outgoing::Impl>(
+            new BinderFirst<Fctor>(fun, std::forward<
+                typename Private::BinderFirstTraits<Fctor>::BoundType>(
+                    bound))));
+    }
 
 
 // class template Chainer
 // Chains two functor calls one after another
+// The first functor gets the arguments as lvalues, since the second one needs
+//     them too
 
-template <typename Fun1, typename Fun2>
-class Chainer : public Fun2::Impl
-{
-    typedef Fun2 Base;
+    template <typename Fun1, typename Fun2,
+        typename Signature = typename Fun2::Signature>
+    class Chainer;
 
-public:
-    typedef typename Base::ResultType ResultType;
-    typedef typename Base::Parm1 Parm1;
-    typedef typename Base::Parm2 Parm2;
+    template <typename Fun1, typename Fun2, typename R, typename... Args>
+    class Chainer<Fun1, Fun2, R (Args...)> : public Fun2::Impl
+    {
+        typedef Fun2 Base;
 
-    Chainer(const Fun1& fun1, const Fun2& fun2) : f1_(fun1), f2_(fun2) {}
+    public:
+        typedef typename Base::ResultType ResultType;
 
-    DEFINE_CLONE_FUNCTORIMPL(Chainer)
+        Chainer(const Fun1& fun1, const Fun2& fun2) : f1_(fun1), f2_(fun2) {}
 
-    // operator() implementations for up to 15 arguments
+        DEFINE_CLONE_FUNCTORIMPL(Chainer)
 
-    ResultType operator()()
-    { return f1_(), f2_(); }
+        ResultType operator()(Args&&... args)
+        { return f1_(args...), f2_(std::forward<Args>(args)...); }
 
-    ResultType operator()(Parm1 p1)
-    { return f1_(p1), f2_(p1); }
-    
-    ResultType operator()(Parm1 p1, Parm2 p2)
-    { return f1_(p1, p2), f2_(p1, p2); }
-    
-private:
-    Fun1 f1_;
-    Fun2 f2_;
-};
+    private:
+        Fun1 f1_;
+        Fun2 f2_;
+    };
 
 
 // function template Chain
 // Chains two functor calls one after another
 
-
-template <class Fun1, class Fun2>
-Fun2 Chain(
-    const Fun1& fun1,
-    const Fun2& fun2)
-{
-    return Fun2(std::auto_ptr<typename Fun2::Impl>(
-        new Chainer<Fun1, Fun2>(fun1, fun2)));
-}
+    template <class Fun1, class Fun2>
+    Fun2 Chain(
+        const Fun1& fun1,
+        const Fun2& fun2)
+    {
+        return Fun2(std::unique_ptr<typename Fun2::Impl>(
+            new Chainer<Fun1, Fun2>(fun1, fun2)));
+    }
+} // namespace Loki
 
 
 #endif  // FUNCTOR_INC_
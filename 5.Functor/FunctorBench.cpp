@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// Cost of keeping callbacks in a std::vector: Functor, SharedFunctor and
+//     std::function, holding a function pointer (small enough to be stored
+//     inline) or a function object with 64 bytes of state (too big for that)
+// Measures filling a reserved vector with copies, growing one (which moves
+//     the elements when it reallocates), copying a whole vector, erasing
+//     from the front (which shifts the rest down by move assignment) and
+//     calling every element
+// Build: g++ -O2 -pthread FunctorBench.cpp ../4.SmallObj/SmallObj.cpp
+//     ../4.SmallObj/Singleton.cpp ../4.SmallObj/HeapProfiler.cpp
+// Usage: ./a.out [elements]
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Functor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+    int Twice(int x)
+    {
+        return 2 * x;
+    }
+
+    struct Bulky
+    {
+        long state_[8];
+
+        int operator()(int x) const
+        {
+            return x + static_cast<int>(state_[0]);
+        }
+    };
+
+    typedef Loki::Functor<int (int)> LokiFunctor;
+    typedef Loki::SharedFunctor<int (int)> LokiSharedFunctor;
+    typedef std::function<int (int)> StdFunction;
+
+    // Defeats dead code elimination
+    volatile int sink;
+
+    typedef std::chrono::steady_clock Clock;
+
+    double NsPer(Clock::time_point start, std::size_t n)
+    {
+        return std::chrono::duration<double, std::nano>(
+            Clock::now() - start).count() / n;
+    }
+
+    struct Costs
+    {
+        double push_, grow_, copy_, erase_, call_;
+    };
+
+    template <class Callback, class Fun>
+    Costs Measure(Fun fun, std::size_t n)
+    {
+        const Callback prototype(fun);
+        double push, grow, copy, erase, call;
+
+        {
+            std::vector<Callback> v;
+            v.reserve(n);
+            Clock::time_point start = Clock::now();
+            for (std::size_t i = 0; i != n; ++i) v.push_back(prototype);
+            push = NsPer(start, n);
+
+            start = Clock::now();
+            int sum = 0;
+            for (std::size_t i = 0; i != n; ++i) sum += v[i](1);
+            call = NsPer(start, n);
+            sink = sum;
+
+            start = Clock::now();
+            std::vector<Callback> w(v);
+            copy = NsPer(start, n);
+            sink = static_cast<int>(w.size());
+        }
+        {
+            std::vector<Callback> v;
+            Clock::time_point start = Clock::now();
+            for (std::size_t i = 0; i != n; ++i) v.push_back(Callback(fun));
+            grow = NsPer(start, n);
+
+            // Quadratic: erases from a tenth of the elements
+            const std::size_t erased = n / 10;
+            v.resize(erased);
+            start = Clock::now();
+            while (!v.empty()) v.erase(v.begin());
+            erase = NsPer(start, erased * erased / 2);
+        }
+
+        Costs costs = { push, grow, copy, erase, call };
+        return costs;
+    }
+
+    // Measures twice and reports the second run, which doesn't pay for the
+    //     first touch of the memory
+    template <class Callback, class Fun>
+    void Row(const char* name, Fun fun, std::size_t n)
+    {
+        Measure<Callback>(fun, n);
+        const Costs c = Measure<Callback>(fun, n);
+        std::printf("%-32s %9.2f %9.2f %9.2f %9.2f %9.2f %6u\n", name,
+            c.push_, c.grow_, c.copy_, c.erase_, c.call_,
+            static_cast<unsigned>(sizeof(Callback)));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 100000;
+    const Bulky bulky = { { 1 } };
+
+    std::printf("ns per element (erase: per element shifted), %lu elements\n",
+        static_cast<unsigned long>(n));
+    std::printf("%-32s %9s %9s %9s %9s %9s %6s\n", "callback", "push",
+        "grow", "copy", "erase", "call", "size");
+    Row<LokiFunctor>("Functor, function pointer", &Twice, n);
+    Row<LokiSharedFunctor>("SharedFunctor, function pointer", &Twice, n);
+    Row<StdFunction>("std::function, function pointer", &Twice, n);
+    Row<LokiFunctor>("Functor, 64-byte object", bulky, n);
+    Row<LokiSharedFunctor>("SharedFunctor, 64-byte object", bulky, n);
+    Row<StdFunction>("std::function, 64-byte object", bulky, n);
+    return 0;
+}